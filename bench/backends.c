@@ -0,0 +1,180 @@
+#include "lib/umap.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Benchmark matrix for the hashtable backends. Runs the same workloads
+ * through the umap with int and string keys and prints one row per key
+ * type for the backend it was built with, ns/op for
+ *
+ *  - insert, adding the keys to an empty map
+ *  - hit and miss, umap_get in random order
+ *  - mixed, 70% gets (half of them misses), 20% adds and 10% deletes
+ *  - delete, removing every key
+ *
+ * and the bytes per entry once all keys are in. Build and run it once per
+ * backend to get the whole matrix:
+ *
+ *     for b in TREE LIST PROBE SWISS CUCKOO; do
+ *         cc -O2 -DHASHTABLE_BACKEND=HASHTABLE_BACKEND_$b -I<dir containing lib/> bench/backends.c src/hash.c src/key-arena.c src/umap.c src/umap/common.c src/hashtable-tree.c src/hashtable-list.c src/hashtable-probe.c src/hashtable-swiss.c src/hashtable-cuckoo.c -o bench-backends
+ *         ./bench-backends [number of keys]
+ *     done
+ */
+
+#define BENCH_DEFAULT_KEYS  (1 << 20)
+#define BENCH_STR_LEN       16
+
+typedef struct {
+    int * ints; /* NULL for string keys */
+    char ** strs;
+    int num; /* 2 * the keys added, the second half is never added */
+} bench_keys_t;
+
+static unsigned long long prng_state = 0x2545f4914f6cdd1dULL;
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64* */
+static unsigned long long bench_rand()
+{
+    prng_state ^= prng_state >> 12;
+    prng_state ^= prng_state << 25;
+    prng_state ^= prng_state >> 27;
+    return prng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static void bench_add(umap_t * map, bench_keys_t * keys, int i, int val)
+{
+    if (keys->ints)
+        umap_add(map, keys->ints[i], val);
+    else
+        umap_add(map, keys->strs[i], val);
+}
+
+static int bench_get(umap_t * map, bench_keys_t * keys, int i)
+{
+    union _umap_datum val;
+
+    if (keys->ints)
+        return umap_get(map, keys->ints[i], &val);
+    else
+        return umap_get(map, keys->strs[i], &val);
+}
+
+static void bench_del(umap_t * map, bench_keys_t * keys, int i)
+{
+    if (keys->ints)
+        umap_del(map, keys->ints[i], NULL);
+    else
+        umap_del(map, keys->strs[i], NULL);
+}
+
+static void bench_backend(const char * key_name, bench_keys_t * keys, int * order)
+{
+    umap_t map;
+    int num_keys = keys->num / 2,
+        i,
+        found = 0;
+    unsigned long long r;
+    double start, insert_secs, hit_secs, miss_secs, mixed_secs, delete_secs, bytes;
+
+    umap_init(&map);
+    umap_val_t_int((&map));
+
+    if (keys->ints)
+        umap_key_t_int((&map));
+    else
+        umap_key_t_str((&map));
+
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        bench_add(&map, keys, i, i);
+
+    insert_secs = bench_now() - start;
+    bytes = (double) umap_memory_usage(&map) / map.ht.size;
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        found += bench_get(&map, keys, order[i]);
+
+    hit_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        found -= bench_get(&map, keys, num_keys + order[i]);
+
+    miss_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+    {
+        r = bench_rand();
+
+        if (r % 100 < 70)
+            bench_get(&map, keys, (r >> 8) % keys->num);
+        else if (r % 100 < 90)
+            bench_add(&map, keys, (r >> 8) % keys->num, i);
+        else
+            bench_del(&map, keys, (r >> 8) % keys->num);
+    }
+
+    mixed_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < keys->num; i++)
+        bench_del(&map, keys, order[i % num_keys] + (i < num_keys ? 0 : num_keys));
+
+    delete_secs = bench_now() - start;
+
+    printf("%-6s %-4s  insert %6.1f  hit %6.1f  miss %6.1f  mixed %6.1f  delete %6.1f ns/op  %5.1f bytes/entry  %s\n",
+        HASHTABLE_BACKEND_NAME, key_name,
+        insert_secs * 1e9 / num_keys, hit_secs * 1e9 / num_keys, miss_secs * 1e9 / num_keys,
+        mixed_secs * 1e9 / num_keys, delete_secs * 1e9 / keys->num, bytes,
+        found == num_keys ? "" : "WRONG RESULTS");
+
+    umap_free(&map);
+}
+
+int main(int argc, char ** argv)
+{
+    int num_keys = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_KEYS,
+        * order = malloc(num_keys * sizeof(int)),
+        i;
+    char * str_buf = malloc(2 * num_keys * (BENCH_STR_LEN + 1));
+    bench_keys_t keys;
+
+    keys.num    = 2 * num_keys;
+    keys.ints   = malloc(keys.num * sizeof(int));
+    keys.strs   = malloc(keys.num * sizeof(char *));
+
+    /* multiplying by an odd constant is a bijection, so all keys differ */
+    for (i = 0; i < keys.num; i++)
+    {
+        keys.ints[i] = (int) ((unsigned int) i * 2654435761u);
+        keys.strs[i] = str_buf + i * (BENCH_STR_LEN + 1);
+        sprintf(keys.strs[i], "%016llx", (unsigned long long) i * 0x9e3779b97f4a7c15ULL);
+    }
+
+    for (i = 0; i < num_keys; i++)
+        order[i] = bench_rand() % num_keys;
+
+    bench_backend("int", &keys, order);
+
+    free(keys.ints);
+    keys.ints = NULL;
+    bench_backend("str", &keys, order);
+
+    free(order);
+    free(str_buf);
+    free(keys.strs);
+
+    return 0;
+}
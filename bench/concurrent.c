@@ -0,0 +1,183 @@
+#include "lib/umap.h"
+#include "lib/umap-concurrent.h"
+#include "lib/umap-rcu.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+/*
+ * Scaling benchmark for the thread safe umaps. Every thread runs the same
+ * mix of adds and gets on random int keys, against one umap behind a single
+ * global mutex, a umap_concurrent and a umap_rcu, for 1 to 64 threads.
+ * Reports the total ops/s of each. The umap_rcu is meant for read mostly
+ * use, run it with a few percent adds or less.
+ *
+ *     cc -O2 -pthread -I<dir containing lib/> bench/concurrent.c src/hash.c src/key-arena.c src/umap.c src/umap/common.c src/umap-concurrent.c src/umap-rcu.c src/hashtable-rcu.c src/hashtable-tree.c -o bench-concurrent
+ *     ./bench-concurrent [ops per thread] [percent adds]
+ */
+
+#define BENCH_DEFAULT_OPS   500000
+#define BENCH_DEFAULT_ADDS  50
+#define BENCH_KEY_BITS      22
+#define BENCH_MAX_THREADS   64
+#define BENCH_QUIESCENT     64 /* umap_rcu gets between quiescent states */
+
+typedef struct {
+    /* only one of the maps is set */
+    umap_t * map;
+    pthread_mutex_t * lock;
+    umap_concurrent_t * cmap;
+    umap_rcu_t * rmap;
+    unsigned long long prng_state;
+    int num_ops,
+        adds;
+} bench_thread_t;
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64*, one state per thread */
+static unsigned long long bench_rand(unsigned long long * state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+static void * bench_thread(void * arg)
+{
+    bench_thread_t * t = arg;
+    union _umap_datum val;
+    umap_rcu_reader_t * reader = NULL;
+    unsigned long long r;
+    int i, key;
+
+    if (t->rmap)
+        reader = umap_rcu_register(t->rmap);
+
+    for (i = 0; i < t->num_ops; i++)
+    {
+        r = bench_rand(&t->prng_state);
+        key = (int) (r >> (64 - BENCH_KEY_BITS));
+
+        if (t->map)
+        {
+            pthread_mutex_lock(t->lock);
+
+            if ((int) (r % 100) < t->adds)
+                umap_add(t->map, key, i);
+            else
+                umap_get(t->map, key, &val);
+
+            pthread_mutex_unlock(t->lock);
+        }
+        else if (t->cmap)
+        {
+            if ((int) (r % 100) < t->adds)
+                umap_concurrent_add(t->cmap, key, i);
+            else
+                umap_concurrent_get(t->cmap, key, &val);
+        }
+        else
+        {
+            if ((int) (r % 100) < t->adds)
+                umap_rcu_add(t->rmap, key, i);
+            else
+                umap_rcu_get(t->rmap, key, &val);
+
+            if (i % BENCH_QUIESCENT == 0)
+                umap_rcu_quiescent(t->rmap, reader);
+        }
+    }
+
+    if (reader)
+        umap_rcu_unregister(t->rmap, reader);
+
+    return NULL;
+}
+
+/*
+ * runs num_threads threads against whichever map isn't NULL, returns ops/s
+ */
+static double bench_run(umap_t * map, umap_concurrent_t * cmap, umap_rcu_t * rmap, int num_threads, int num_ops, int adds)
+{
+    pthread_t threads[BENCH_MAX_THREADS];
+    bench_thread_t args[BENCH_MAX_THREADS];
+    pthread_mutex_t lock;
+    double start;
+    int i;
+
+    pthread_mutex_init(&lock, NULL);
+
+    for (i = 0; i < num_threads; i++)
+    {
+        args[i].map         = map;
+        args[i].lock        = &lock;
+        args[i].cmap        = cmap;
+        args[i].rmap        = rmap;
+        args[i].prng_state  = 0x2545f4914f6cdd1dULL * (i + 1);
+        args[i].num_ops     = num_ops;
+        args[i].adds        = adds;
+    }
+
+    start = bench_now();
+
+    for (i = 0; i < num_threads; i++)
+        pthread_create(&threads[i], NULL, bench_thread, &args[i]);
+
+    for (i = 0; i < num_threads; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&lock);
+
+    return (double) num_threads * num_ops / (bench_now() - start);
+}
+
+int main(int argc, char ** argv)
+{
+    int num_ops = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_OPS,
+        adds = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_ADDS,
+        num_threads;
+    double global_ops, sharded_ops, rcu_ops;
+    umap_t * map;
+    umap_concurrent_t * cmap;
+    umap_rcu_t * rmap;
+
+    printf("%d ops per thread, %d%% adds, %d shards\n", num_ops, adds, UMAP_CONCURRENT_SHARDS);
+
+    for (num_threads = 1; num_threads <= BENCH_MAX_THREADS; num_threads *= 2)
+    {
+        map = umap_create();
+        umap_key_t_int(map);
+        umap_val_t_int(map);
+
+        global_ops = bench_run(map, NULL, NULL, num_threads, num_ops, adds);
+        umap_destroy(map);
+
+        cmap = umap_concurrent_create(0);
+        umap_key_t_int(cmap);
+        umap_val_t_int(cmap);
+
+        sharded_ops = bench_run(NULL, cmap, NULL, num_threads, num_ops, adds);
+        umap_concurrent_destroy(cmap);
+
+        rmap = umap_rcu_create();
+        umap_key_t_int(rmap);
+        umap_val_t_int(rmap);
+
+        rcu_ops = bench_run(NULL, NULL, rmap, num_threads, num_ops, adds);
+        umap_rcu_destroy(rmap);
+
+        printf("%2d threads  global mutex %6.2f Mops/s  sharded %6.2f Mops/s  rcu %6.2f Mops/s\n",
+            num_threads, global_ops / 1e6, sharded_ops / 1e6, rcu_ops / 1e6);
+    }
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "lib/umap-frozen.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Benchmark of umap_freeze against the mutable umap it was built from. For
+ * maps from cache sized up to well past the last level cache it prints
+ *
+ *  - the time umap_freeze takes and the bits per key of the perfect hash
+ *  - bytes per entry of the umap and of the frozen copy
+ *  - umap_get and umap_frozen_get ns/op for hits and misses in random order
+ *
+ *     cc -O2 -I<dir containing lib/> bench/freeze.c src/hash.c src/key-arena.c src/umap.c src/umap-frozen.c src/umap/common.c src/hashtable-tree.c -o bench-freeze
+ *     ./bench-freeze [largest number of keys]
+ */
+
+#define BENCH_DEFAULT_KEYS  4000000
+#define BENCH_MIN_KEYS      5000
+#define BENCH_LOOKUPS       (1 << 22)
+
+static unsigned long long prng_state = 0x2545f4914f6cdd1dULL;
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64*, only used to pick the lookup order */
+static unsigned long long bench_rand()
+{
+    prng_state ^= prng_state >> 12;
+    prng_state ^= prng_state << 25;
+    prng_state ^= prng_state >> 27;
+    return prng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static void bench_freeze(int num_keys, int * order)
+{
+    umap_t map;
+    umap_frozen_t * frozen;
+    union _umap_datum val;
+    int i, found = 0;
+    double start, freeze_secs, hit_secs, miss_secs, frozen_hit_secs, frozen_miss_secs;
+
+    umap_init(&map);
+    umap_key_t_int((&map));
+    umap_val_t_int((&map));
+
+    for (i = 0; i < num_keys; i++)
+        umap_add(&map, i, i);
+
+    start = bench_now();
+    frozen = umap_freeze(&map);
+    freeze_secs = bench_now() - start;
+
+    if (!frozen)
+    {
+        printf("%9d keys  no perfect hash found\n", num_keys);
+        umap_free(&map);
+        return;
+    }
+
+    /* the order holds random numbers, reduce them to keys in the map */
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found += umap_get(&map, order[i] % num_keys, &val);
+
+    hit_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found -= umap_get(&map, num_keys + order[i] % num_keys, &val);
+
+    miss_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found += umap_frozen_get(frozen, order[i] % num_keys, &val);
+
+    frozen_hit_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found -= umap_frozen_get(frozen, num_keys + order[i] % num_keys, &val);
+
+    frozen_miss_secs = bench_now() - start;
+
+    printf("%9d keys  freeze %7.3f s  %4.2f bits/key  bytes/entry %5.1f -> %5.1f  hit %6.1f -> %6.1f  miss %6.1f -> %6.1f ns/op  %s\n",
+        num_keys, freeze_secs, umap_frozen_bits_per_key(frozen),
+        (double) umap_memory_usage(&map) / num_keys, (double) umap_frozen_memory_usage(frozen) / num_keys,
+        hit_secs * 1e9 / BENCH_LOOKUPS, frozen_hit_secs * 1e9 / BENCH_LOOKUPS,
+        miss_secs * 1e9 / BENCH_LOOKUPS, frozen_miss_secs * 1e9 / BENCH_LOOKUPS,
+        found == 2 * BENCH_LOOKUPS ? "" : "WRONG RESULTS");
+
+    umap_frozen_destroy(frozen);
+    umap_free(&map);
+}
+
+int main(int argc, char ** argv)
+{
+    int max_keys = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_KEYS,
+        num_keys,
+        i;
+    int * order = malloc(BENCH_LOOKUPS * sizeof(int));
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        order[i] = bench_rand() >> 34;
+
+    printf("%s backend, mutable -> frozen\n", HASHTABLE_BACKEND_NAME);
+
+    for (num_keys = BENCH_MIN_KEYS; num_keys <= max_keys; num_keys *= 3)
+        bench_freeze(num_keys, order);
+
+    free(order);
+
+    return 0;
+}
@@ -0,0 +1,437 @@
+#include "lib/hash.h"
+#include "lib/umap.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/*
+ * Benchmark and quality suite for the hash functions in lib/hash.h.
+ *
+ *  - throughput in GB/s and ns/hash for key lengths from 1 byte to 4 KB
+ *  - full 64 bit and bucket collisions over generated key corpora
+ *  - avalanche bias, how far each output bit is from flipping with
+ *    probability 1/2 when a single input bit is flipped
+ *  - end to end umap_add / umap_get throughput with each hash plugged in
+ *
+ * The corpora (sequential ints, uuid strings, url paths and words) are
+ * generated from a fixed prng seed so runs are reproducible.
+ *
+ *     cc -O2 -I<dir containing lib/> bench/hash.c src/hash.c src/key-arena.c src/umap.c src/umap/common.c src/hashtable-tree.c -lm -o bench-hash
+ *     ./bench-hash [number of keys]
+ */
+
+#define BENCH_BYTES             (256 * 1024 * 1024)
+#define BENCH_DEFAULT_KEYS      (1 << 20)
+#define BENCH_AVALANCHE_RUNS    20000
+#define BENCH_AVALANCHE_LEN     16
+
+typedef struct {
+    const char * name;
+    hash_type_t type;
+} bench_hash_t;
+
+static bench_hash_t hashes[] = {
+    {"djb2",    HASH_TYPE_DJB2},
+    {"murmur",  HASH_TYPE_MURMUR},
+    {"siphash", HASH_TYPE_SIPHASH}
+};
+
+#define NUM_HASHES (sizeof(hashes) / sizeof(hashes[0]))
+
+typedef enum {
+    CORPUS_INTS,
+    CORPUS_UUIDS,
+    CORPUS_URLS,
+    CORPUS_WORDS
+} bench_corpus_type_t;
+
+typedef struct {
+    const char * name;
+    bench_corpus_type_t type;
+    char ** keys;   /* NULL for the int corpus */
+    int num_keys;
+} bench_corpus_t;
+
+static hash_seed_t seed;
+static unsigned long long prng_state = 0x2545f4914f6cdd1dULL;
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64*, only used to generate reproducible corpora */
+static unsigned long long bench_rand()
+{
+    prng_state ^= prng_state >> 12;
+    prng_state ^= prng_state << 25;
+    prng_state ^= prng_state >> 27;
+    return prng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static int ulong_cmp(const void * a, const void * b)
+{
+    unsigned long x = *(const unsigned long *) a,
+                  y = *(const unsigned long *) b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * corpus generation
+ */
+
+static void bench_word(char * buf)
+{
+    static const char * syllables[] = {
+        "ka", "lo", "mi", "ne", "ru", "sa", "te", "vi", "zo", "qua",
+        "tion", "ing", "er", "st", "pre", "con", "al", "ous", "ly", "ment"
+    };
+    int i, n = 1 + bench_rand() % 4;
+
+    buf[0] = '\0';
+
+    for (i = 0; i < n; i++)
+        strcat(buf, syllables[bench_rand() % 20]);
+}
+
+static void bench_corpus_init(bench_corpus_t * c, const char * name, bench_corpus_type_t type, int num_keys)
+{
+    static const char * resources[] = {"users", "orders", "items", "carts", "sessions", "images"},
+                      * actions[] = {"profile", "history", "settings", "edit", "thumbnail"};
+    unsigned long long a, b;
+    char buf[128];
+    int i;
+
+    c->name = name;
+    c->type = type;
+    c->num_keys = num_keys;
+    c->keys = NULL;
+
+    if (type == CORPUS_INTS)
+        return;
+
+    c->keys = malloc(sizeof(char *) * num_keys);
+
+    for (i = 0; i < num_keys; i++)
+    {
+        switch (type)
+        {
+            case CORPUS_UUIDS:
+                a = bench_rand(),
+                b = bench_rand();
+                snprintf(buf, sizeof(buf), "%08llx-%04llx-4%03llx-%04llx-%012llx",
+                    a >> 32, (a >> 16) & 0xffff, a & 0xfff, (b >> 48) | 0x8000, b & 0xffffffffffffULL);
+                break;
+            case CORPUS_URLS:
+                snprintf(buf, sizeof(buf), "/api/v%d/%s/%d/%s",
+                    (int) (1 + bench_rand() % 3), resources[bench_rand() % 6], i, actions[bench_rand() % 5]);
+                break;
+            case CORPUS_WORDS:
+                /* words repeat, so suffix the index to keep the keys unique */
+                bench_word(buf);
+                snprintf(buf + strlen(buf), 16, "%d", i);
+                break;
+            default:
+                break;
+        }
+
+        c->keys[i] = strdup(buf);
+    }
+}
+
+static void bench_corpus_free(bench_corpus_t * c)
+{
+    int i;
+
+    if (!c->keys)
+        return;
+
+    for (i = 0; i < c->num_keys; i++)
+        free(c->keys[i]);
+
+    free(c->keys);
+}
+
+static unsigned long bench_corpus_hash(bench_hash_t * h, bench_corpus_t * c, int i)
+{
+    if (c->type == CORPUS_INTS)
+        return hash_int_type(h->type, &seed, (unsigned int) i);
+
+    return hash_str_type(h->type, &seed, c->keys[i]);
+}
+
+/*
+ * throughput
+ */
+
+static void bench_throughput(bench_hash_t * h, int len)
+{
+    char * buf = malloc(len);
+    long i, iters = BENCH_BYTES / (len < 16 ? 16 : len);
+    unsigned long sink = 0;
+    double start, secs;
+
+    for (i = 0; i < len; i++)
+        buf[i] = 'a' + i % 26;
+
+    start = bench_now();
+
+    for (i = 0; i < iters; i++)
+    {
+        buf[0] = (char) i; /* keep the compiler from hoisting the hash */
+        sink += hash_bytes_type(h->type, &seed, buf, len);
+    }
+
+    secs = bench_now() - start;
+
+    printf("%-8s len %5d  %7.3f GB/s  %8.2f ns/hash  (%lx)\n", h->name, len,
+        (double) iters * len / secs / 1e9, secs * 1e9 / iters, sink & 0xf);
+
+    free(buf);
+}
+
+/*
+ * integer keys through the byte loop versus the dedicated integer mixer
+ */
+static void bench_int(bench_hash_t * h)
+{
+    long i, iters = BENCH_BYTES / 4;
+    unsigned long sink = 0;
+    int k;
+    double start, bytes_secs, int_secs;
+
+    start = bench_now();
+
+    for (i = 0; i < iters; i++)
+    {
+        k = (int) i;
+        sink += hash_bytes_type(h->type, &seed, &k, sizeof(k));
+    }
+
+    bytes_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < iters; i++)
+        sink += hash_int_type(h->type, &seed, (unsigned int) i);
+
+    int_secs = bench_now() - start;
+
+    printf("%-8s int keys  %6.2f ns/hash bytes  %6.2f ns/hash mixer  (%lx)\n", h->name,
+        bytes_secs * 1e9 / iters, int_secs * 1e9 / iters, sink & 0xf);
+}
+
+/*
+ * quality
+ */
+
+/*
+ * Counts keys that share a full hash, and keys that share a bucket in a
+ * power of two table and a prime table of about the same size as the key
+ * count. The mask column is also printed as a ratio to what a random
+ * function would give, anything well above 1 means the low bits cluster.
+ */
+static void bench_collisions(bench_hash_t * h, bench_corpus_t * c)
+{
+    int n = c->num_keys;
+    unsigned long * hv = malloc(sizeof(unsigned long) * n),
+                  * mv = malloc(sizeof(unsigned long) * n),
+                  * pv = malloc(sizeof(unsigned long) * n),
+                  mask = 1,
+                  prime = 1048573;
+    long i, full = 0, masked = 0, primed = 0;
+    double expected;
+
+    while (mask < (unsigned long) n)
+        mask <<= 1;
+    mask--;
+
+    for (i = 0; i < n; i++)
+    {
+        hv[i] = bench_corpus_hash(h, c, i);
+        mv[i] = hv[i] & mask;
+        pv[i] = hv[i] % prime;
+    }
+
+    qsort(hv, n, sizeof(unsigned long), ulong_cmp);
+    qsort(mv, n, sizeof(unsigned long), ulong_cmp);
+    qsort(pv, n, sizeof(unsigned long), ulong_cmp);
+
+    for (i = 1; i < n; i++)
+    {
+        full    += hv[i] == hv[i - 1];
+        masked  += mv[i] == mv[i - 1];
+        primed  += pv[i] == pv[i - 1];
+    }
+
+    /* expected number of keys landing in an already used bucket */
+    expected = n - (mask + 1) * (1 - exp(-(double) n / (mask + 1)));
+
+    printf("%-8s %-6s %8d keys  %4ld full  %8ld mask (%.2fx)  %8ld prime\n",
+        h->name, c->name, n, full, masked, masked / expected, primed);
+
+    free(hv);
+    free(mv);
+    free(pv);
+}
+
+/*
+ * Flips every input bit of random keys and records how often each output
+ * bit flips. Reports the worst and mean distance from the ideal 0.5, at
+ * this sample size a good hash has a worst bias around 0.01.
+ */
+static void bench_avalanche(bench_hash_t * h, int use_int)
+{
+    static long flips[BENCH_AVALANCHE_LEN * 8][64];
+    unsigned char key[BENCH_AVALANCHE_LEN];
+    unsigned long long x;
+    unsigned long base, diff;
+    int run, in, out, in_bits = use_int ? 64 : BENCH_AVALANCHE_LEN * 8;
+    double bias, worst = 0, total = 0;
+
+    memset(flips, 0, sizeof(flips));
+
+    for (run = 0; run < BENCH_AVALANCHE_RUNS; run++)
+    {
+        x = bench_rand();
+
+        for (in = 0; in < BENCH_AVALANCHE_LEN; in++)
+            key[in] = bench_rand();
+
+        base = use_int ? hash_int_type(h->type, &seed, x) : hash_bytes_type(h->type, &seed, key, sizeof(key));
+
+        for (in = 0; in < in_bits; in++)
+        {
+            if (use_int)
+            {
+                diff = base ^ hash_int_type(h->type, &seed, x ^ (1ULL << in));
+            }
+            else
+            {
+                key[in / 8] ^= 1 << (in % 8);
+                diff = base ^ hash_bytes_type(h->type, &seed, key, sizeof(key));
+                key[in / 8] ^= 1 << (in % 8);
+            }
+
+            for (out = 0; out < 64; out++)
+                flips[in][out] += (diff >> out) & 1;
+        }
+    }
+
+    for (in = 0; in < in_bits; in++)
+    {
+        for (out = 0; out < 64; out++)
+        {
+            bias = fabs((double) flips[in][out] / BENCH_AVALANCHE_RUNS - 0.5);
+            total += bias;
+
+            if (bias > worst)
+                worst = bias;
+        }
+    }
+
+    printf("%-8s %-6s avalanche  worst bias %.4f  mean bias %.4f\n", h->name,
+        use_int ? "int" : "bytes", worst, total / (in_bits * 64));
+}
+
+/*
+ * end to end
+ */
+
+static void bench_umap(bench_hash_t * h, bench_corpus_t * c)
+{
+    umap_t map;
+    union _umap_datum val;
+    int i, found = 0;
+    double start, add_secs, get_secs;
+
+    umap_init(&map);
+    map.ht.hash_type = h->type;
+    umap_val_t_int((&map));
+
+    if (c->type == CORPUS_INTS)
+        umap_key_t_int((&map));
+
+    start = bench_now();
+
+    for (i = 0; i < c->num_keys; i++)
+    {
+        if (c->keys)
+            umap_add(&map, c->keys[i], i);
+        else
+            umap_add(&map, i, i);
+    }
+
+    add_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < c->num_keys; i++)
+    {
+        if (c->keys)
+            found += umap_get(&map, c->keys[i], &val);
+        else
+            found += umap_get(&map, i, &val);
+    }
+
+    get_secs = bench_now() - start;
+
+    printf("%-8s %-6s umap_add %7.1f ns/op  umap_get %7.1f ns/op  %s\n", h->name, c->name,
+        add_secs * 1e9 / c->num_keys, get_secs * 1e9 / c->num_keys,
+        found == c->num_keys ? "" : "MISSING KEYS");
+
+    umap_free(&map);
+}
+
+int main(int argc, char ** argv)
+{
+    static const int lens[] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 4096};
+    bench_corpus_t corpora[4];
+    unsigned int i, j;
+    int num_keys = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_KEYS;
+
+    hash_seed_random(&seed);
+
+    bench_corpus_init(&corpora[0], "ints",  CORPUS_INTS,  num_keys);
+    bench_corpus_init(&corpora[1], "uuids", CORPUS_UUIDS, num_keys);
+    bench_corpus_init(&corpora[2], "urls",  CORPUS_URLS,  num_keys);
+    bench_corpus_init(&corpora[3], "words", CORPUS_WORDS, num_keys);
+
+    puts("== throughput");
+
+    for (i = 0; i < NUM_HASHES; i++)
+        for (j = 0; j < sizeof(lens) / sizeof(lens[0]); j++)
+            bench_throughput(&hashes[i], lens[j]);
+
+    for (i = 0; i < NUM_HASHES; i++)
+        bench_int(&hashes[i]);
+
+    puts("== collisions");
+
+    for (j = 0; j < 4; j++)
+        for (i = 0; i < NUM_HASHES; i++)
+            bench_collisions(&hashes[i], &corpora[j]);
+
+    puts("== avalanche");
+
+    for (i = 0; i < NUM_HASHES; i++)
+    {
+        bench_avalanche(&hashes[i], 0);
+        bench_avalanche(&hashes[i], 1);
+    }
+
+    puts("== umap");
+
+    for (j = 0; j < 4; j++)
+        for (i = 0; i < NUM_HASHES; i++)
+            bench_umap(&hashes[i], &corpora[j]);
+
+    for (j = 0; j < 4; j++)
+        bench_corpus_free(&corpora[j]);
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "lib/umap.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Benchmark of string keys the umap owns against keys the caller strdups
+ * one by one. For maps from cache sized up to past the last level cache it
+ * prints insert (strdup included) and hit ns/op in random order, then the
+ * hit ns/op again after three quarters of the keys were deleted and as
+ * many new ones added, which compacts the owned keys on the way.
+ *
+ *     cc -O2 -I<dir containing lib/> bench/keys.c src/hash.c src/key-arena.c src/umap.c src/umap/common.c src/hashtable-tree.c -o bench-keys
+ *     ./bench-keys [largest number of keys]
+ */
+
+#define BENCH_DEFAULT_KEYS  4000000
+#define BENCH_MIN_KEYS      5000
+#define BENCH_LOOKUPS       (1 << 22)
+#define BENCH_STR_LEN       24
+
+static unsigned long long prng_state = 0x2545f4914f6cdd1dULL;
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64*, only used to pick the lookup order */
+static unsigned long long bench_rand()
+{
+    prng_state ^= prng_state >> 12;
+    prng_state ^= prng_state << 25;
+    prng_state ^= prng_state >> 27;
+    return prng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static void bench_key(char * buf, int i)
+{
+    sprintf(buf, "key-%020llx", (unsigned long long) i * 0x9e3779b97f4a7c15ULL);
+}
+
+/*
+ * the hits of BENCH_LOOKUPS random keys among first .. first + num_keys - 1
+ */
+static double bench_hits(umap_t * map, char ** keys, int first, int num_keys, int * order, int * found)
+{
+    double start = bench_now();
+    int i, val;
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        *found += umap_get_si(map, keys[first + order[i] % num_keys], &val);
+
+    return bench_now() - start;
+}
+
+static void bench_keys(int num_keys, char ** keys, int own, int * order)
+{
+    umap_t map;
+    int num_churn = num_keys / 4 * 3,
+        i, val,
+        found = 0;
+    char ** dups = own ? NULL : malloc((num_keys + num_churn) * sizeof(char *)),
+         buf[BENCH_STR_LEN + 1];
+    double start, insert_secs, hit_secs, churn_hit_secs;
+
+    umap_init(&map);
+    umap_key_t_str((&map));
+    umap_val_t_int((&map));
+
+    if (own)
+        umap_own_keys((&map));
+
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+    {
+        /* the key is built in a scratch buffer, as if it came off the wire */
+        bench_key(buf, i);
+
+        if (own)
+            umap_put_si(&map, buf, i);
+        else
+            umap_put_si(&map, dups[i] = strdup(buf), i);
+    }
+
+    insert_secs = bench_now() - start;
+    hit_secs = bench_hits(&map, keys, 0, num_keys, order, &found);
+
+    /* swap the first three quarters of the keys for new ones */
+    for (i = 0; i < num_churn; i++)
+    {
+        umap_del(&map, keys[i], &val);
+
+        if (!own)
+            free(dups[i]);
+    }
+
+    for (i = num_keys; i < num_keys + num_churn; i++)
+    {
+        if (own)
+            umap_put_si(&map, keys[i], i);
+        else
+            umap_put_si(&map, dups[i] = strdup(keys[i]), i);
+    }
+
+    churn_hit_secs = bench_hits(&map, keys, num_churn, num_keys, order, &found);
+
+    printf("%-6s %9d keys  insert %6.1f  hit %6.1f  hit after churn %6.1f ns/op  %s\n",
+        own ? "owned" : "strdup", num_keys,
+        insert_secs * 1e9 / num_keys, hit_secs * 1e9 / BENCH_LOOKUPS, churn_hit_secs * 1e9 / BENCH_LOOKUPS,
+        found == 2 * BENCH_LOOKUPS ? "" : "WRONG RESULTS");
+
+    umap_free(&map);
+
+    if (!own)
+    {
+        for (i = num_churn; i < num_keys + num_churn; i++)
+            free(dups[i]);
+
+        free(dups);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    int max_keys = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_KEYS,
+        num_keys,
+        i;
+    int * order = malloc(BENCH_LOOKUPS * sizeof(int));
+    char * str_buf = malloc((max_keys * 2) * (BENCH_STR_LEN + 1)),
+         ** keys = malloc(max_keys * 2 * sizeof(char *));
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        order[i] = bench_rand() >> 34;
+
+    for (i = 0; i < max_keys * 2; i++)
+    {
+        keys[i] = str_buf + i * (BENCH_STR_LEN + 1);
+        bench_key(keys[i], i);
+    }
+
+    printf("%s backend\n", HASHTABLE_BACKEND_NAME);
+
+    for (num_keys = BENCH_MIN_KEYS; num_keys <= max_keys; num_keys *= 3)
+    {
+        bench_keys(num_keys, keys, 0, order);
+        bench_keys(num_keys, keys, 1, order);
+    }
+
+    free(keys);
+    free(str_buf);
+    free(order);
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "lib/umap.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Benchmark for the memory layout of the hashtable backend the umap is
+ * linked against.
+ *
+ *  - bytes per entry of the table and its metadata (overflow nodes of the
+ *    tree and list backends are not counted)
+ *  - umap_get ns/op for hits and misses in random order, for maps from
+ *    cache sized up to well past the last level cache
+ *  - umap_get_many ns/op for the same hits, BENCH_BATCH keys per call
+ *
+ * Compare the probe backend with -DHASHTABLE_PROBE_SOA=0 and =1.
+ *
+ *     cc -O2 -DHASHTABLE_BACKEND=HASHTABLE_BACKEND_PROBE -I<dir containing lib/> bench/layout.c src/hash.c src/key-arena.c src/umap.c src/umap/common.c src/hashtable-probe.c -o bench-layout
+ *     ./bench-layout [largest number of keys]
+ */
+
+#define BENCH_DEFAULT_KEYS  4000000
+#define BENCH_MIN_KEYS      5000
+#define BENCH_LOOKUPS       (1 << 22)
+#define BENCH_BATCH         128
+
+static unsigned long long prng_state = 0x2545f4914f6cdd1dULL;
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64*, only used to pick the lookup order */
+static unsigned long long bench_rand()
+{
+    prng_state ^= prng_state >> 12;
+    prng_state ^= prng_state << 25;
+    prng_state ^= prng_state >> 27;
+    return prng_state * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * bytes of the entry array plus whatever per slot metadata the backend keeps
+ */
+static double bench_table_bytes(umap_t * map)
+{
+    double bytes = (double) map->ht.table_size * map->ht.entry_size;
+
+#if HASHTABLE_BACKEND == HASHTABLE_BACKEND_PROBE && HASHTABLE_PROBE_SOA
+    bytes += (double) map->ht.table_size * sizeof(hashtable_meta_t);
+#endif
+#if HASHTABLE_BACKEND == HASHTABLE_BACKEND_SWISS
+    bytes += map->ht.table_size + HASHTABLE_SWISS_GROUP_WIDTH;
+#endif
+#if HASHTABLE_BACKEND == HASHTABLE_BACKEND_CUCKOO
+    bytes += map->ht.table_size + HASHTABLE_CUCKOO_STASH * map->ht.entry_size;
+#endif
+
+    return bytes;
+}
+
+static void bench_layout(int num_keys, int * order, int * keys)
+{
+    umap_t map;
+    union _umap_datum val,
+                      vals[BENCH_BATCH];
+    int i, found = 0, batch_found = 0;
+    double start, hit_secs, miss_secs, batch_secs;
+
+    umap_init(&map);
+    umap_key_t_int((&map));
+    umap_val_t_int((&map));
+
+    for (i = 0; i < num_keys; i++)
+        umap_add(&map, i, i);
+
+    /* the order holds random numbers, reduce them to keys in the map */
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found += umap_get(&map, order[i] % num_keys, &val);
+
+    hit_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found -= umap_get(&map, num_keys + order[i] % num_keys, &val);
+
+    miss_secs = bench_now() - start;
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        keys[i] = order[i] % num_keys;
+
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i += BENCH_BATCH)
+        batch_found += umap_get_many(&map, keys + i, BENCH_BATCH, vals, NULL);
+
+    batch_secs = bench_now() - start;
+
+    printf("%9d keys  %6.1f bytes/entry  load %.2f  hit %6.1f ns/op  miss %6.1f ns/op  batch hit %6.1f ns/op  %s\n",
+        num_keys, bench_table_bytes(&map) / map.ht.size, (double) map.ht.size / map.ht.table_size,
+        hit_secs * 1e9 / BENCH_LOOKUPS, miss_secs * 1e9 / BENCH_LOOKUPS, batch_secs * 1e9 / BENCH_LOOKUPS,
+        found == BENCH_LOOKUPS && batch_found == BENCH_LOOKUPS ? "" : "WRONG RESULTS");
+
+    umap_free(&map);
+}
+
+int main(int argc, char ** argv)
+{
+    int max_keys = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_KEYS,
+        num_keys,
+        i;
+    int * order = malloc(BENCH_LOOKUPS * sizeof(int)),
+        * keys = malloc(BENCH_LOOKUPS * sizeof(int));
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        order[i] = bench_rand() >> 34;
+
+    printf("sizeof(umap_entry_t) = %d\n", (int) sizeof(umap_entry_t));
+
+    for (num_keys = BENCH_MIN_KEYS; num_keys <= max_keys; num_keys *= 3)
+        bench_layout(num_keys, order, keys);
+
+    free(order);
+    free(keys);
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "lib/umap.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Benchmark of how the hashtable backend holds up as its table fills. For
+ * each load factor from .5 to .95 one table of the same size is filled to
+ * that load and measured for
+ *
+ *  - insert ns/op, adding the keys to the reserved table
+ *  - hit and miss ns/op, umap_get in random order
+ *  - the longest probe any entry needs, from umap_stats (slots for the probe
+ *    backend, buckets for the cuckoo backend)
+ *
+ * It also walks every table with umap_next, which near full load covers
+ * the stash of the cuckoo backend, and flags a walk that misses or repeats
+ * an entry.
+ *
+ * The backends resize before .95 by default, raise HASHTABLE_LOAD_FACTOR so
+ * the table keeps its size. Build it for the backends to compare:
+ *
+ *     for b in PROBE CUCKOO; do
+ *         cc -O2 -DHASHTABLE_BACKEND=HASHTABLE_BACKEND_$b -DHASHTABLE_LOAD_FACTOR=.96 -I<dir containing lib/> bench/load.c src/hash.c src/key-arena.c src/umap.c src/umap/common.c src/hashtable-probe.c src/hashtable-cuckoo.c -o bench-load
+ *         ./bench-load [table size in entries]
+ *     done
+ */
+
+#define BENCH_DEFAULT_SIZE  (1 << 20)
+#define BENCH_LOOKUPS       (1 << 21)
+
+static unsigned long long prng_state = 0x2545f4914f6cdd1dULL;
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64*, only used to pick the lookup order */
+static unsigned long long bench_rand()
+{
+    prng_state ^= prng_state >> 12;
+    prng_state ^= prng_state << 25;
+    prng_state ^= prng_state >> 27;
+    return prng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static void bench_load(unsigned long size, double load, int * order)
+{
+    umap_t map;
+    union _umap_datum val;
+    hashtable_stats_t stats;
+    umap_cursor_t cursor;
+    umap_entry_t * entry;
+    unsigned long table_size,
+                  walked = 0;
+    unsigned long long key_sum = 0;
+    int num_keys,
+        i,
+        found = 0;
+    double start, insert_secs, hit_secs, miss_secs;
+
+    umap_init(&map);
+    umap_key_t_int((&map));
+    umap_val_t_int((&map));
+
+    /* the same table size for every load, filled past what was reserved */
+    umap_reserve(&map, size / 2);
+    table_size = map.ht.table_size;
+    num_keys = load * table_size;
+
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        umap_add(&map, i, i);
+
+    insert_secs = bench_now() - start;
+    start = bench_now();
+
+    /* the order holds random numbers, reduce them to keys in the map */
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found += umap_get(&map, order[i] % num_keys, &val);
+
+    hit_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found -= umap_get(&map, num_keys + order[i] % num_keys, &val);
+
+    miss_secs = bench_now() - start;
+
+    umap_stats(&map, &stats);
+
+    /* the keys are 0 .. num_keys - 1, a walk that sees each once adds up to their sum */
+    umap_foreach(&map, &cursor, entry)
+    {
+        walked++;
+        key_sum += entry->key.i;
+    }
+
+    printf("%-6s load %.2f  insert %6.1f  hit %6.1f  miss %6.1f ns/op  max probe %3lu  %s%s%s\n",
+        HASHTABLE_BACKEND_NAME, stats.load_factor,
+        insert_secs * 1e9 / num_keys, hit_secs * 1e9 / BENCH_LOOKUPS, miss_secs * 1e9 / BENCH_LOOKUPS,
+        stats.max_chain,
+        found == BENCH_LOOKUPS ? "" : "WRONG RESULTS ",
+        walked == num_keys && key_sum == (unsigned long long) num_keys * (num_keys - 1) / 2 ? "" : "WRONG WALK ",
+        stats.table_size == table_size ? "" : "(resized)");
+
+    umap_free(&map);
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned long size = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_SIZE;
+    int * order = malloc(BENCH_LOOKUPS * sizeof(int)),
+        i;
+    double load;
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        order[i] = bench_rand() >> 34;
+
+    for (load = .5; load < .96; load += .05)
+        bench_load(size, load, order);
+
+    free(order);
+
+    return 0;
+}
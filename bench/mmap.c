@@ -0,0 +1,128 @@
+#include "lib/umap-mmap.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Benchmark of starting from a saved umap image instead of rebuilding the
+ * map. Prints
+ *
+ *  - the time to build the map with umap_add from string keys, and to save it
+ *  - the time for umap_open_mmap, and for the first BENCH_LOOKUPS lookups
+ *    against the freshly mapped image
+ *  - umap_get and umap_mmap_get ns/op once everything is cached
+ *
+ *     cc -O2 -I<dir containing lib/> bench/mmap.c src/hash.c src/key-arena.c src/umap.c src/umap-mmap.c src/umap/common.c src/hashtable-tree.c -o bench-mmap
+ *     ./bench-mmap [number of keys] [image path]
+ *
+ * To see a really cold start, drop the page cache between saving and
+ * opening (echo 1 > /proc/sys/vm/drop_caches) and run with a saved image.
+ */
+
+#define BENCH_DEFAULT_KEYS  (1 << 21)
+#define BENCH_LOOKUPS       (1 << 20)
+#define BENCH_STR_LEN       16
+
+static unsigned long long prng_state = 0x2545f4914f6cdd1dULL;
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64*, only used to pick the lookup order */
+static unsigned long long bench_rand()
+{
+    prng_state ^= prng_state >> 12;
+    prng_state ^= prng_state << 25;
+    prng_state ^= prng_state >> 27;
+    return prng_state * 0x2545f4914f6cdd1dULL;
+}
+
+int main(int argc, char ** argv)
+{
+    int num_keys = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_KEYS,
+        i,
+        found = 0;
+    const char * path = argc > 2 ? argv[2] : "bench-mmap.img";
+    char * str_buf = malloc(num_keys * (BENCH_STR_LEN + 1)),
+         ** keys = malloc(num_keys * sizeof(char *));
+    int * order = malloc(BENCH_LOOKUPS * sizeof(int));
+    union _umap_datum val;
+    umap_t map;
+    umap_mmap_t * image;
+    double start, build_secs, save_secs, open_secs, first_secs, get_secs, mmap_get_secs;
+
+    for (i = 0; i < num_keys; i++)
+    {
+        keys[i] = str_buf + i * (BENCH_STR_LEN + 1);
+        sprintf(keys[i], "%016llx", (unsigned long long) i * 0x9e3779b97f4a7c15ULL);
+    }
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        order[i] = bench_rand() % num_keys;
+
+    umap_init(&map);
+    umap_key_t_str((&map));
+    umap_val_t_int((&map));
+
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        umap_add(&map, keys[i], i);
+
+    build_secs = bench_now() - start;
+    start = bench_now();
+
+    if (umap_save(&map, path) < 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    save_secs = bench_now() - start;
+    start = bench_now();
+
+    if (!(image = umap_open_mmap(path)))
+    {
+        perror(path);
+        return 1;
+    }
+
+    open_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found += umap_mmap_get(image, keys[order[i]], &val);
+
+    first_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found -= umap_get(&map, keys[order[i]], &val);
+
+    get_secs = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found += umap_mmap_get(image, keys[order[i]], &val);
+
+    mmap_get_secs = bench_now() - start;
+
+    printf("%d keys  build %.3f s  save %.3f s  open %.6f s  first %d lookups %.3f s\n",
+        num_keys, build_secs, save_secs, open_secs, BENCH_LOOKUPS, first_secs);
+    printf("umap_get %6.1f ns/op  umap_mmap_get %6.1f ns/op  %s\n",
+        get_secs * 1e9 / BENCH_LOOKUPS, mmap_get_secs * 1e9 / BENCH_LOOKUPS,
+        found == BENCH_LOOKUPS ? "" : "WRONG RESULTS");
+
+    umap_mmap_close(image);
+    umap_free(&map);
+    free(order);
+    free(keys);
+    free(str_buf);
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include "lib/umap.h"
+#include "lib/umap-template.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Benchmark of a table generated by UMAP_DECLARE against the generic umap,
+ * with int keys and
+ *
+ *  - int values, the generic umap through umap_put_ii and umap_get_ii
+ *  - a 24 byte struct value, which the generic umap can only hold boxed,
+ *    every value malloced and stored as a data pointer
+ *
+ * Prints insert, hit and miss ns/op in random order and bytes per entry
+ * (not counting the boxes) for maps from cache sized up to past the last
+ * level cache.
+ *
+ *     cc -O2 -I<dir containing lib/> bench/template.c src/hash.c src/key-arena.c src/umap.c src/umap/common.c src/hashtable-tree.c -o bench-template
+ *     ./bench-template [largest number of keys]
+ */
+
+#define BENCH_DEFAULT_KEYS  4000000
+#define BENCH_MIN_KEYS      5000
+#define BENCH_LOOKUPS       (1 << 22)
+
+typedef struct {
+    double x,
+           y;
+    int tag;
+} bench_val_t;
+
+UMAP_DECLARE(bench_ii, int, int, umap_template_int_hash, umap_template_int_eq)
+UMAP_DECLARE(bench_is, int, bench_val_t, umap_template_int_hash, umap_template_int_eq)
+
+static unsigned long long prng_state = 0x2545f4914f6cdd1dULL;
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64*, only used to pick the lookup order */
+static unsigned long long bench_rand()
+{
+    prng_state ^= prng_state >> 12;
+    prng_state ^= prng_state << 25;
+    prng_state ^= prng_state >> 27;
+    return prng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static void bench_print(const char * what, int num_keys, double * secs, double * bytes, long found)
+{
+    printf("%-6s %9d keys  insert %6.1f -> %6.1f  hit %6.1f -> %6.1f  miss %6.1f -> %6.1f ns/op  bytes/entry %5.1f -> %5.1f  %s\n",
+        what, num_keys,
+        secs[0] * 1e9 / num_keys, secs[1] * 1e9 / num_keys,
+        secs[2] * 1e9 / BENCH_LOOKUPS, secs[3] * 1e9 / BENCH_LOOKUPS,
+        secs[4] * 1e9 / BENCH_LOOKUPS, secs[5] * 1e9 / BENCH_LOOKUPS,
+        bytes[0] / num_keys, bytes[1] / num_keys,
+        found == 0 ? "" : "WRONG RESULTS");
+}
+
+static void bench_int(int num_keys, int * order)
+{
+    umap_t map;
+    bench_ii_t tmap;
+    int i, val, * tval;
+    long found = 0;
+    double secs[6], bytes[2], start;
+
+    umap_init(&map);
+    umap_key_t_int((&map));
+    umap_val_t_int((&map));
+    bench_ii_init(&tmap);
+
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        umap_put_ii(&map, i, i);
+
+    secs[0] = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        bench_ii_put(&tmap, i, i);
+
+    secs[1] = bench_now() - start;
+
+    /* the order holds random numbers, reduce them to keys in the map */
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found += umap_get_ii(&map, order[i] % num_keys, &val) && val == order[i] % num_keys;
+
+    secs[2] = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found -= (tval = bench_ii_get(&tmap, order[i] % num_keys)) && *tval == order[i] % num_keys;
+
+    secs[3] = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found += umap_get_ii(&map, num_keys + order[i] % num_keys, &val);
+
+    secs[4] = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found -= bench_ii_get(&tmap, num_keys + order[i] % num_keys) != NULL;
+
+    secs[5] = bench_now() - start;
+
+    bytes[0] = umap_memory_usage(&map);
+    bytes[1] = bench_ii_memory_usage(&tmap);
+
+    bench_print("int", num_keys, secs, bytes, found);
+
+    umap_free(&map);
+    bench_ii_free(&tmap);
+}
+
+static void bench_struct(int num_keys, int * order)
+{
+    umap_t map;
+    bench_is_t tmap;
+    bench_val_t val,
+                * box,
+                * tval;
+    int i;
+    long found = 0;
+    double secs[6], bytes[2], start;
+
+    umap_init(&map);
+    umap_key_t_int((&map));
+    umap_val_t_data((&map));
+    bench_is_init(&tmap);
+
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+    {
+        box = malloc(sizeof(bench_val_t));
+        box->x = box->y = i;
+        box->tag = i;
+        umap_put_ip(&map, i, box);
+    }
+
+    secs[0] = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+    {
+        val.x = val.y = i;
+        val.tag = i;
+        bench_is_put(&tmap, i, val);
+    }
+
+    secs[1] = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found += umap_get_ip(&map, order[i] % num_keys, (void **) &box) && box->tag == order[i] % num_keys;
+
+    secs[2] = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found -= (tval = bench_is_get(&tmap, order[i] % num_keys)) && tval->tag == order[i] % num_keys;
+
+    secs[3] = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found += umap_get_ip(&map, num_keys + order[i] % num_keys, (void **) &box);
+
+    secs[4] = bench_now() - start;
+    start = bench_now();
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        found -= bench_is_get(&tmap, num_keys + order[i] % num_keys) != NULL;
+
+    secs[5] = bench_now() - start;
+
+    bytes[0] = umap_memory_usage(&map);
+    bytes[1] = bench_is_memory_usage(&tmap);
+
+    bench_print("struct", num_keys, secs, bytes, found);
+
+    for (i = 0; i < num_keys; i++)
+    {
+        if (umap_get_ip(&map, i, (void **) &box))
+            free(box);
+    }
+
+    umap_free(&map);
+    bench_is_free(&tmap);
+}
+
+int main(int argc, char ** argv)
+{
+    int max_keys = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_KEYS,
+        num_keys,
+        i;
+    int * order = malloc(BENCH_LOOKUPS * sizeof(int));
+
+    for (i = 0; i < BENCH_LOOKUPS; i++)
+        order[i] = bench_rand() >> 34;
+
+    printf("%s backend umap -> UMAP_DECLARE\n", HASHTABLE_BACKEND_NAME);
+
+    for (num_keys = BENCH_MIN_KEYS; num_keys <= max_keys; num_keys *= 3)
+    {
+        bench_int(num_keys, order);
+        bench_struct(num_keys, order);
+    }
+
+    free(order);
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "lib/umap.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Benchmark of the typed umap functions against umap_add and umap_get,
+ * which go through the argument list and switch on the key and value
+ * types on every call. Prints insert and hit ns/op for int and string keys
+ * on a map that fits in cache, where the call overhead shows the most.
+ *
+ *     cc -O2 -I<dir containing lib/> bench/typed.c src/hash.c src/key-arena.c src/umap.c src/umap/common.c src/hashtable-tree.c -o bench-typed
+ *     ./bench-typed [number of keys]
+ */
+
+#define BENCH_DEFAULT_KEYS  (1 << 14)
+#define BENCH_ROUNDS        64
+#define BENCH_STR_LEN       16
+
+static double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_int(int num_keys)
+{
+    umap_t map;
+    int i, r, val,
+        found = 0;
+    double start, add_secs, get_secs, put_ii_secs, get_ii_secs;
+
+    umap_init(&map);
+    umap_key_t_int((&map));
+    umap_val_t_int((&map));
+
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        umap_add(&map, i, i);
+
+    add_secs = bench_now() - start;
+    umap_free(&map);
+
+    umap_init(&map);
+    umap_key_t_int((&map));
+    umap_val_t_int((&map));
+
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        umap_put_ii(&map, i, i);
+
+    put_ii_secs = bench_now() - start;
+    start = bench_now();
+
+    for (r = 0; r < BENCH_ROUNDS; r++)
+        for (i = 0; i < num_keys; i++)
+            found += umap_get(&map, i, &val);
+
+    get_secs = bench_now() - start;
+    start = bench_now();
+
+    for (r = 0; r < BENCH_ROUNDS; r++)
+        for (i = 0; i < num_keys; i++)
+            found -= umap_get_ii(&map, i, &val);
+
+    get_ii_secs = bench_now() - start;
+
+    printf("int  umap_add %6.1f  umap_put_ii %6.1f  umap_get %6.1f  umap_get_ii %6.1f ns/op  %s\n",
+        add_secs * 1e9 / num_keys, put_ii_secs * 1e9 / num_keys,
+        get_secs * 1e9 / num_keys / BENCH_ROUNDS, get_ii_secs * 1e9 / num_keys / BENCH_ROUNDS,
+        found == 0 ? "" : "WRONG RESULTS");
+
+    umap_free(&map);
+}
+
+static void bench_str(int num_keys, char ** keys)
+{
+    umap_t map;
+    int i, r, val,
+        found = 0;
+    double start, add_secs, get_secs, put_si_secs, get_si_secs;
+
+    umap_init(&map);
+    umap_key_t_str((&map));
+    umap_val_t_int((&map));
+
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        umap_add(&map, keys[i], i);
+
+    add_secs = bench_now() - start;
+    umap_free(&map);
+
+    umap_init(&map);
+    umap_key_t_str((&map));
+    umap_val_t_int((&map));
+
+    start = bench_now();
+
+    for (i = 0; i < num_keys; i++)
+        umap_put_si(&map, keys[i], i);
+
+    put_si_secs = bench_now() - start;
+    start = bench_now();
+
+    for (r = 0; r < BENCH_ROUNDS; r++)
+        for (i = 0; i < num_keys; i++)
+            found += umap_get(&map, keys[i], &val);
+
+    get_secs = bench_now() - start;
+    start = bench_now();
+
+    for (r = 0; r < BENCH_ROUNDS; r++)
+        for (i = 0; i < num_keys; i++)
+            found -= umap_get_si(&map, keys[i], &val);
+
+    get_si_secs = bench_now() - start;
+
+    printf("str  umap_add %6.1f  umap_put_si %6.1f  umap_get %6.1f  umap_get_si %6.1f ns/op  %s\n",
+        add_secs * 1e9 / num_keys, put_si_secs * 1e9 / num_keys,
+        get_secs * 1e9 / num_keys / BENCH_ROUNDS, get_si_secs * 1e9 / num_keys / BENCH_ROUNDS,
+        found == 0 ? "" : "WRONG RESULTS");
+
+    umap_free(&map);
+}
+
+int main(int argc, char ** argv)
+{
+    int num_keys = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_KEYS,
+        i;
+    char * str_buf = malloc(num_keys * (BENCH_STR_LEN + 1)),
+         ** keys = malloc(num_keys * sizeof(char *));
+
+    for (i = 0; i < num_keys; i++)
+    {
+        keys[i] = str_buf + i * (BENCH_STR_LEN + 1);
+        sprintf(keys[i], "%016llx", (unsigned long long) i * 0x9e3779b97f4a7c15ULL);
+    }
+
+    printf("%s backend, %d keys\n", HASHTABLE_BACKEND_NAME, num_keys);
+
+    bench_int(num_keys);
+    bench_str(num_keys, keys);
+
+    free(keys);
+    free(str_buf);
+
+    return 0;
+}
@@ -1,12 +1,39 @@
 #ifndef _LIB_HASH_H
 #define _LIB_HASH_H
 
-/* simple byte hashes implementing the djb2 algorithm */
+/*
+ * simple byte hashes. hash_str and hash_bytes implement the djb2 algorithm,
+ * the hash_murmur_* functions implement the 64 bit MurmurHash64A algorithm
+ * which consumes 8 bytes per step, and the hash_sip_* functions implement
+ * the keyed SipHash-1-3.
+ *
+ * Use siphash with a random seed for keys that come from untrusted input.
+ * djb2 and murmur have collisions that don't depend on the seed, so an
+ * attacker can still flood a single bucket with them.
+ */
 
 /*
- * TODO - Implement Murmur3 hashing algorithm along with MSCV (MicroSoftVisualStudio) compatibility for inttypes.
- * see https://github.com/jemalloc/jemalloc for decent implementation of the murmur hash along with MSVC compatibility.
+ * identifies which hash function a hashtable keys its entries with
  */
+typedef enum {
+    HASH_TYPE_DJB2,
+    HASH_TYPE_MURMUR,
+    HASH_TYPE_SIPHASH
+} hash_type_t;
+
+/*
+ * 128 bit key for the seeded hashes. siphash uses both halves, murmur
+ * only uses k0 and djb2 ignores the seed.
+ */
+typedef struct {
+    unsigned long long k0,
+                       k1;
+} hash_seed_t;
+
+/*
+ * fills the seed with random bits, every call gives a different seed
+ */
+void hash_seed_random(hash_seed_t *);
 
 /*
  * Accepts a null-terminated string to hash
@@ -19,4 +46,45 @@ unsigned long hash_str(char * str);
  */
 unsigned long hash_bytes(void * vdata, int len);
 
+/*
+ * murmur versions of the above. On platforms where unsigned long is only
+ * 32 bits (MSVC) the 64 bit hash is truncated.
+ */
+unsigned long hash_murmur_str(char * str);
+unsigned long hash_murmur_bytes(void * vdata, int len);
+
+/*
+ * siphash versions of the above, keyed with the seed
+ */
+unsigned long hash_sip_str(char * str, const hash_seed_t *);
+unsigned long hash_sip_bytes(void * vdata, int len, const hash_seed_t *);
+
+/*
+ * hashes integer and double keys with the splitmix64 finalizer, a handful
+ * of multiplies and shifts instead of a byte loop. Doubles are normalized
+ * first so -0.0 and 0.0 hash the same, as do all NaNs.
+ */
+unsigned long hash_int(unsigned long long x);
+unsigned long hash_double(double d);
+
+/*
+ * hashes a null-terminated string and stores its length in len, walking the
+ * string only once. The hash is the same as hash_bytes_type over len bytes.
+ */
+unsigned long hash_str_len(hash_type_t, const hash_seed_t *, char * str, int * len);
+
+/*
+ * hash with the function identified by the hash type. A NULL seed uses
+ * the default fixed seed.
+ */
+unsigned long hash_str_type(hash_type_t, const hash_seed_t *, char * str);
+unsigned long hash_bytes_type(hash_type_t, const hash_seed_t *, void * vdata, int len);
+
+/*
+ * integer and double keys are mixed with the seed for djb2 and murmur,
+ * siphash tables still run them through siphash.
+ */
+unsigned long hash_int_type(hash_type_t, const hash_seed_t *, unsigned long long x);
+unsigned long hash_double_type(hash_type_t, const hash_seed_t *, double d);
+
 #endif
@@ -0,0 +1,152 @@
+#ifndef _LIB_HASHTABLE_CUCKOO_H
+#define _LIB_HASHTABLE_CUCKOO_H
+
+#include "lib/hash.h"
+#include "lib/hashtable-stats.h"
+
+/*
+ * Bucketized cuckoo backend of the hashtable, included through
+ * lib/hashtable.h.
+ *
+ * Every entry lives in one of two buckets of HASHTABLE_CUCKOO_SLOTS slots,
+ * both picked from its hash, or in a small stash for the few that found no
+ * room. A lookup reads the one byte tags of the two buckets and only the
+ * entries whose tag matches, so it never looks anywhere else no matter how
+ * full the table is. Inserts that find both buckets full move entries to
+ * their other bucket along the shortest path found by a breadth first
+ * search.
+ */
+
+#ifndef HASHTABLE_LOAD_FACTOR
+#define HASHTABLE_LOAD_FACTOR .9
+#endif
+
+/* slots per bucket, the tags of a bucket are read as one word */
+#define HASHTABLE_CUCKOO_SLOTS 4
+
+/* entries that can wait in the stash before the table has to grow */
+#ifndef HASHTABLE_CUCKOO_STASH
+#define HASHTABLE_CUCKOO_STASH 8
+#endif
+
+/* limits of the search for a path of displacements */
+#ifndef HASHTABLE_CUCKOO_MAX_PATH
+#define HASHTABLE_CUCKOO_MAX_PATH 5
+#endif
+
+#ifndef HASHTABLE_CUCKOO_BFS_NODES
+#define HASHTABLE_CUCKOO_BFS_NODES 256
+#endif
+
+/* the fields the umap and uset entries start with, tag is their struct tag */
+#define HASHTABLE_ENTRY_HEADER(tag) \
+    int is_occupied; \
+    unsigned long hash;
+
+/* the umap and uset entries need to share the same
+ * memory layout as this struct or BAD things will
+ * happen. The tags decide if a slot is used,
+ * is_occupied is only kept for the shared layout.
+ */
+typedef struct {
+    int is_occupied;
+    unsigned long hash;
+} hashtable_entry_t;
+
+/* how many entries ahead hashtable_lookup_batch prefetches */
+#ifndef HASHTABLE_PREFETCH_DISTANCE
+#define HASHTABLE_PREFETCH_DISTANCE 16
+#endif
+
+typedef enum {
+    HASHTABLE_LOOKUP_INSERT,
+    HASHTABLE_LOOKUP_SEARCH,
+    HASHTABLE_LOOKUP_DELETE
+} hashtable_lookup_t;
+
+typedef struct {
+    /* array of hash entries, HASHTABLE_CUCKOO_SLOTS per bucket */
+    void * table,
+         * entry_cmp_state; /* arbitrary data to pass along to the entry_cmp func */
+
+    unsigned char * tags; /* one per slot, 0 for an empty slot */
+    void * stash; /* HASHTABLE_CUCKOO_STASH entries */
+
+    unsigned long table_size, /* number of slots, a power of two */
+                  size, /* number of entries in hash table */
+                  mask, /* number of buckets - 1 */
+                  resize_at; /* size that triggers a resize */
+
+    int prime_idx,  /* log2 of the number of buckets */
+        entry_size, /* size of the entries for the hash table */
+        stash_size; /* entries in the stash */
+    int (*entry_cmp)(void *, void *, void *); /* entry, entry, state. returns 0 if equal, like strcmp */
+    hash_type_t hash_type; /* hash function the entries are keyed with */
+    hash_seed_t hash_seed; /* per table seed for the hash function */
+    HASHTABLE_STATS_FIELDS /* counters, only with HASHTABLE_STATS */
+
+} hashtable_t;
+
+hashtable_t * hashtable_create(int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
+void hashtable_init(hashtable_t *, int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
+
+/*
+ * for HASHTABLE_LOOKUP_DELETE the removed entry is copied into the passed
+ * entry and that is returned.
+ */
+void * hashtable_lookup_entry(hashtable_t *, void * /* entry */, hashtable_lookup_t);
+
+/*
+ * searches for num entries laid out one after another in entries and stores
+ * the matching table entry, or NULL, in results. Both buckets are
+ * prefetched HASHTABLE_PREFETCH_DISTANCE entries ahead of the one being
+ * resolved so the cache misses of the batch overlap. Returns the number of
+ * entries found.
+ */
+int hashtable_lookup_batch(hashtable_t *, void * /* entries */, int /* num */, void ** /* results */);
+
+/*
+ * grows the table so count entries fit without another resize. The table
+ * itself is only allocated by the first insert, reserving before that just
+ * picks its size.
+ */
+void hashtable_reserve(hashtable_t *, unsigned long /* count */);
+
+/*
+ * shrinks the table to the smallest size that holds its entries. An empty
+ * table gives back all of its memory until the next insert.
+ */
+void hashtable_shrink_to_fit(hashtable_t *);
+
+void hashtable_print(hashtable_t *);
+
+/*
+ * bytes allocated by the table, the entries, their tags and the stash.
+ * Doesn't include the hashtable_t itself.
+ */
+unsigned long hashtable_memory_usage(hashtable_t *);
+
+/*
+ * fills in the counters (with HASHTABLE_STATS) and the current shape of the
+ * table, see hashtable-stats.h. Walks the whole table.
+ */
+void hashtable_stats(hashtable_t *, hashtable_stats_t *);
+
+/* position of a walk over the entries, see hashtable_next */
+typedef struct {
+    unsigned long idx; /* next slot to look at */
+} hashtable_cursor_t;
+
+#define hashtable_cursor_init(c) ((c)->idx = 0)
+
+/*
+ * returns the entry after the cursor and moves the cursor past it, or NULL
+ * once all entries were returned. The slots are scanned in memory order,
+ * the stash last. The table mustn't change during a walk.
+ */
+void * hashtable_next(hashtable_t *, hashtable_cursor_t *);
+
+void hashtable_free(hashtable_t *);
+void hashtable_destroy(hashtable_t *);
+
+#endif
@@ -1,9 +1,12 @@
-#ifndef _LIB_HASHTABLE_H
-#define _LIB_HASHTABLE_H
+#ifndef _LIB_HASHTABLE_LIST_H
+#define _LIB_HASHTABLE_LIST_H
+
+#include "lib/hash.h"
+#include "lib/hashtable-stats.h"
 
 /*
- * The hashtable is an internal use only data structure used to implement the 
- * umap and uset.
+ * List backend of the hashtable, included through lib/hashtable.h. Each
+ * bucket of the prime sized table chains the entries that collide there.
  */
 
 #ifndef HASHTABLE_LOAD_FACTOR
@@ -14,6 +17,12 @@
 #define HASHTABLE_PROBE_LINEAR 1
 #endif
 
+/* the fields the umap and uset entries start with, tag is their struct tag */
+#define HASHTABLE_ENTRY_HEADER(tag) \
+    int is_occupied; \
+    unsigned long hash; \
+    struct tag * next;
+
 /* the umap and uset entries need to share the same
  * memory layout as this struct or BAD things will
  * happen
@@ -25,6 +34,11 @@ typedef struct _hashtable_entry {
                                * right;*/
 } hashtable_entry_t;
 
+/* how many entries ahead hashtable_lookup_batch prefetches */
+#ifndef HASHTABLE_PREFETCH_DISTANCE
+#define HASHTABLE_PREFETCH_DISTANCE 16
+#endif
+
 typedef enum {
     HASHTABLE_LOOKUP_INSERT,
     HASHTABLE_LOOKUP_SEARCH,
@@ -41,17 +55,74 @@ typedef struct {
     
     int prime_idx,  /* index into the prime doubles array */
         entry_size; /* size of the entries for the hash table */
-    int (*entry_cmp)(void *, void *, void *); /* entry, entry, state */
+    int (*entry_cmp)(void *, void *, void *); /* entry, entry, state. returns 0 if equal, like strcmp */
+    hash_type_t hash_type; /* hash function the entries are keyed with */
+    hash_seed_t hash_seed; /* per table seed for the hash function */
+    HASHTABLE_STATS_FIELDS /* counters, only with HASHTABLE_STATS */
 
 } hashtable_t;
 
-hashtable_t * hashtable_create(int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */);
-void hashtable_init(hashtable_t *, int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */);
+hashtable_t * hashtable_create(int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
+void hashtable_init(hashtable_t *, int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
 
+/*
+ * for HASHTABLE_LOOKUP_DELETE the removed entry is copied into the passed
+ * entry and that is returned.
+ */
 void * hashtable_lookup_entry(hashtable_t *, void * /* entry */, hashtable_lookup_t);
 
+/*
+ * searches for num entries laid out one after another in entries and stores
+ * the matching table entry, or NULL, in results. The home slots are
+ * prefetched HASHTABLE_PREFETCH_DISTANCE entries ahead of the one being
+ * resolved so the cache misses of the batch overlap. Returns the number of
+ * entries found.
+ */
+int hashtable_lookup_batch(hashtable_t *, void * /* entries */, int /* num */, void ** /* results */);
+
+/*
+ * grows the table so count entries fit without another resize. The table
+ * itself is only allocated by the first insert, reserving before that just
+ * picks its size.
+ */
+void hashtable_reserve(hashtable_t *, unsigned long /* count */);
+
+/*
+ * shrinks the table to the smallest size that holds its entries. An empty
+ * table gives back all of its memory until the next insert.
+ */
+void hashtable_shrink_to_fit(hashtable_t *);
+
 void hashtable_print(hashtable_t *);
 
+/*
+ * bytes allocated by the table, the entry arrays plus any overflow nodes.
+ * Doesn't include the hashtable_t itself.
+ */
+unsigned long hashtable_memory_usage(hashtable_t *);
+
+/*
+ * fills in the counters (with HASHTABLE_STATS) and the current shape of the
+ * table, see hashtable-stats.h. Walks the whole table.
+ */
+void hashtable_stats(hashtable_t *, hashtable_stats_t *);
+
+/* position of a walk over the entries, see hashtable_next */
+typedef struct {
+    unsigned long idx; /* next bucket to look at */
+    hashtable_entry_t * node; /* next overflow node of the bucket before idx */
+} hashtable_cursor_t;
+
+#define hashtable_cursor_init(c) ((c)->idx = 0, (c)->node = NULL)
+
+/*
+ * returns the entry after the cursor and moves the cursor past it, or NULL
+ * once all entries were returned. Buckets are visited in the order they
+ * sit in the table, each followed by its overflow nodes. The table
+ * mustn't change during a walk.
+ */
+void * hashtable_next(hashtable_t *, hashtable_cursor_t *);
+
 void hashtable_free(hashtable_t *);
 void hashtable_destroy(hashtable_t *);
 
@@ -0,0 +1,151 @@
+#ifndef _LIB_HASHTABLE_PROBE_CORE_H
+#define _LIB_HASHTABLE_PROBE_CORE_H
+
+/*
+ * The probing of the open addressing backend, written once as a macro so
+ * the typed tables of lib/umap-template.h run the same code with their
+ * hashing and key comparison inlined. Doesn't depend on the backend picked
+ * in lib/hashtable.h.
+ *
+ * HASHTABLE_PROBE_CORE generates three functions for a table type:
+ *
+ *  - prefix_probe, walks the probe run of a key
+ *  - prefix_shift, makes room for a new entry at a slot
+ *  - prefix_remove, empties a slot
+ *
+ * on top of accessor macros the table provides, each taking the table
+ * pointer first:
+ *
+ *  home_idx(t, hash), next_idx(t, idx), prev_idx(t, idx)
+ *  slot_dist(t, idx)       probe distance + 1 of the slot, 0 if empty. Assigned to
+ *  slot_match(t, idx, fp)  whether the fingerprint of the slot is fp, or just 1
+ *  key_match(t, idx, key)  whether the slot holds key
+ *  move_slot(t, dst, src)  copies the entry and its metadata from src to dst
+ *  count_probe(t, len)     records the length of a probe for the stats
+ *
+ * robin_hood is a constant 0 or 1, see HASHTABLE_PROBE_ROBIN_HOOD.
+ */
+
+/* per slot metadata, kept in an array apart from the entries */
+typedef struct {
+    unsigned int fingerprint, /* the hash folded to 32 bits */
+                 dist; /* 0 if empty, otherwise the probe distance from the home slot + 1 */
+} hashtable_probe_meta_t;
+
+#define hashtable_probe_fingerprint(hash) ((unsigned int) ((hash) ^ ((unsigned long long) (hash) >> 32)))
+
+#define HASHTABLE_PROBE_CORE(scope, prefix, table_type, key_type, robin_hood, home_idx, next_idx, prev_idx, slot_dist, slot_match, key_match, move_slot, count_probe) \
+    /* \
+     * Walks the probe run of the key. Returns the index of the matching \
+     * entry with found set, otherwise the index the key should be placed \
+     * at and its distance from the home slot there. With only_empty set \
+     * entries are never compared, used when reinserting entries that are \
+     * known to be unique. \
+     */ \
+    scope unsigned long prefix##_probe(table_type * this, key_type key, unsigned long hash, int only_empty, int * dist, int * found) \
+    { \
+        unsigned long idx = home_idx(this, hash); \
+        unsigned int fp = hashtable_probe_fingerprint(hash), \
+                     cur_dist; \
+        \
+        (void) fp; \
+        *dist = 0; \
+        *found = 0; \
+        \
+        while (1) \
+        { \
+            cur_dist = slot_dist(this, idx); \
+            \
+            /* robin hood keeps runs ordered by home slot, so a search can stop at the first richer entry */ \
+            if (cur_dist == 0 || (robin_hood && (int) cur_dist - 1 < *dist)) \
+            { \
+                count_probe(this, *dist + 1); \
+                return idx; \
+            } \
+            \
+            /* the entry itself is only read when the fingerprint matches */ \
+            if (!only_empty && slot_match(this, idx, fp) && key_match(this, idx, key)) \
+            { \
+                *found = 1; \
+                count_probe(this, *dist + 1); \
+                return idx; \
+            } \
+            \
+            idx = next_idx(this, idx); /* linear */ \
+            (*dist)++; \
+        } \
+    } \
+    \
+    /* \
+     * Empties idx for an entry the caller puts there. With robin hood the \
+     * slot may hold a richer entry, in that case the rest of the run is \
+     * shifted one slot further from home up to the next empty slot, which \
+     * is the same as the richer entries swapping places one after another. \
+     */ \
+    scope void prefix##_shift(table_type * this, unsigned long idx) \
+    { \
+        unsigned long empty = idx, \
+                      prev; \
+        \
+        while (slot_dist(this, empty)) \
+            empty = next_idx(this, empty); \
+        \
+        while (empty != idx) \
+        { \
+            prev = prev_idx(this, empty); \
+            \
+            move_slot(this, empty, prev); \
+            slot_dist(this, empty)++; \
+            \
+            empty = prev; \
+        } \
+    } \
+    \
+    /* \
+     * Empties the slot at idx without breaking any probe run that passes \
+     * through it. \
+     */ \
+    scope void prefix##_remove(table_type * this, unsigned long idx) \
+    { \
+        unsigned long next = next_idx(this, idx); \
+        int gap = 1; \
+        \
+        if (robin_hood) \
+        { \
+            /* backward shift, pull the run back until an entry already sits at home */ \
+            while (slot_dist(this, next) > 1) \
+            { \
+                move_slot(this, idx, next); \
+                slot_dist(this, idx)--; \
+                \
+                idx = next; \
+                next = next_idx(this, next); \
+            } \
+        } \
+        else \
+        { \
+            /* \
+             * Knuth's algorithm R. Plain linear runs aren't ordered by home \
+             * slot, so scan the whole run for entries whose home is at or \
+             * before the hole. \
+             */ \
+            while (slot_dist(this, next)) \
+            { \
+                if ((int) slot_dist(this, next) - 1 >= gap) \
+                { \
+                    move_slot(this, idx, next); \
+                    slot_dist(this, idx) -= gap; \
+                    \
+                    idx = next; \
+                    gap = 0; \
+                } \
+                \
+                next = next_idx(this, next); \
+                gap++; \
+            } \
+        } \
+        \
+        slot_dist(this, idx) = 0; \
+    }
+
+#endif
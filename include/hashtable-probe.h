@@ -1,28 +1,86 @@
-#ifndef _LIB_HASHTABLE_H
-#define _LIB_HASHTABLE_H
+#ifndef _LIB_HASHTABLE_PROBE_H
+#define _LIB_HASHTABLE_PROBE_H
+
+#include "lib/hash.h"
+#include "lib/hashtable-stats.h"
+#include "lib/hashtable-probe-core.h"
 
 /*
- * The hashtable is an internal use only data structure used to implement the 
- * umap and uset.
+ * Open addressing backend of the hashtable, included through
+ * lib/hashtable.h. Linear probing, optionally robin hood. The probing
+ * itself is in lib/hashtable-probe-core.h.
  */
 
+#ifndef HASHTABLE_PROBE_LINEAR
+#define HASHTABLE_PROBE_LINEAR 1
+#endif
+
+/*
+ * robin hood probing. An insert takes the slot of any entry that is closer
+ * to its home than the new entry is, so probe lengths stay short and even
+ * at high load, lookups stop as soon as they pass a richer entry, and
+ * deletes shift the rest of the run back instead of leaving tombstones.
+ */
+#ifndef HASHTABLE_PROBE_ROBIN_HOOD
+#define HASHTABLE_PROBE_ROBIN_HOOD 1
+#endif
+
 #ifndef HASHTABLE_LOAD_FACTOR
+#if HASHTABLE_PROBE_ROBIN_HOOD
+#define HASHTABLE_LOAD_FACTOR .9
+#else
 #define HASHTABLE_LOAD_FACTOR .8
 #endif
+#endif
 
-#ifndef HASHTABLE_PROBE_LINEAR
-#define HASHTABLE_PROBE_LINEAR 1
+/*
+ * size the table in powers of two and pick slots with a mask instead of a
+ * modulo against a prime. Only the low bits of the hash choose the slot, so
+ * this needs a well mixed hash (murmur, siphash or the int mixer, not djb2).
+ */
+#ifndef HASHTABLE_PROBE_POW2
+#define HASHTABLE_PROBE_POW2 1
+#endif
+
+/*
+ * keep the probe distances and 32 bit hash fingerprints in their own
+ * array, apart from the entries. Probing then only scans the compact
+ * metadata, 8 slots per cache line, and reads an entry once its
+ * fingerprint matches. That makes misses in tables past the cache faster,
+ * but the entries keep their full hash (lookups pass it in the entry
+ * header), so it costs the 8 bytes of metadata per slot on top of them.
+ * Off by default.
+ */
+#ifndef HASHTABLE_PROBE_SOA
+#define HASHTABLE_PROBE_SOA 0
 #endif
 
+/*
+ * the fields the umap and uset entries start with, tag is their struct
+ * tag. is_occupied comes second so an int after the header fills the
+ * padding.
+ */
+#define HASHTABLE_ENTRY_HEADER(tag) \
+    unsigned long hash; \
+    int is_occupied;
+
 /* the umap and uset entries need to share the same
  * memory layout as this struct or BAD things will
  * happen
  */
 typedef struct {
-    int is_occupied;
     unsigned long hash;
+    int is_occupied; /* 0 if empty, otherwise the probe distance from the home slot + 1. Unused with HASHTABLE_PROBE_SOA */
 } hashtable_entry_t;
 
+/* per slot metadata for HASHTABLE_PROBE_SOA, dist is the same as is_occupied above */
+typedef hashtable_probe_meta_t hashtable_meta_t;
+
+/* how many entries ahead hashtable_lookup_batch prefetches */
+#ifndef HASHTABLE_PREFETCH_DISTANCE
+#define HASHTABLE_PREFETCH_DISTANCE 16
+#endif
+
 typedef enum {
     HASHTABLE_LOOKUP_INSERT,
     HASHTABLE_LOOKUP_SEARCH,
@@ -34,24 +92,81 @@ typedef struct {
     void * table,
          * entry_cmp_state; /* arbitrary data to pass along to the entry_cmp func */
     
+    hashtable_meta_t * meta; /* metadata for each entry in the table, NULL without HASHTABLE_PROBE_SOA */
+    
     unsigned long table_size, /* size of the allocated table */
-                  size; /* number of entries in hash table */
+                  size, /* number of entries in hash table */
+                  mask, /* table_size - 1 when sized in powers of two */
+                  resize_at; /* size that triggers the next resize */
     
-    int prime_idx,  /* index into the prime doubles array */
-        mod,
-        mask,
+    int prime_idx,  /* index into the prime doubles array, or the power of two */
         entry_size; /* size of the entries for the hash table */
-    int (*entry_cmp)(void *, void *, void *); /* entry, entry, state */
+    int (*entry_cmp)(void *, void *, void *); /* entry, entry, state. returns 0 if equal, like strcmp */
+    hash_type_t hash_type; /* hash function the entries are keyed with */
+    hash_seed_t hash_seed; /* per table seed for the hash function */
+    HASHTABLE_STATS_FIELDS /* counters, only with HASHTABLE_STATS */
 
 } hashtable_t;
 
-hashtable_t * hashtable_create(int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */);
-void hashtable_init(hashtable_t *, int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */);
+hashtable_t * hashtable_create(int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
+void hashtable_init(hashtable_t *, int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
 
+/*
+ * for HASHTABLE_LOOKUP_DELETE the removed entry is copied into the passed
+ * entry and that is returned, since the slot is refilled by the shift.
+ */
 void * hashtable_lookup_entry(hashtable_t *, void * /* entry */, hashtable_lookup_t);
 
+/*
+ * searches for num entries laid out one after another in entries and stores
+ * the matching table entry, or NULL, in results. The home slots are
+ * prefetched HASHTABLE_PREFETCH_DISTANCE entries ahead of the one being
+ * resolved so the cache misses of the batch overlap. Returns the number of
+ * entries found.
+ */
+int hashtable_lookup_batch(hashtable_t *, void * /* entries */, int /* num */, void ** /* results */);
+
+/*
+ * grows the table so count entries fit without another resize. The table
+ * itself is only allocated by the first insert, reserving before that just
+ * picks its size.
+ */
+void hashtable_reserve(hashtable_t *, unsigned long /* count */);
+
+/*
+ * shrinks the table to the smallest size that holds its entries. An empty
+ * table gives back all of its memory until the next insert.
+ */
+void hashtable_shrink_to_fit(hashtable_t *);
+
 void hashtable_print(hashtable_t *);
 
+/*
+ * bytes allocated by the table, the entry arrays plus any overflow nodes.
+ * Doesn't include the hashtable_t itself.
+ */
+unsigned long hashtable_memory_usage(hashtable_t *);
+
+/*
+ * fills in the counters (with HASHTABLE_STATS) and the current shape of the
+ * table, see hashtable-stats.h. Walks the whole table.
+ */
+void hashtable_stats(hashtable_t *, hashtable_stats_t *);
+
+/* position of a walk over the entries, see hashtable_next */
+typedef struct {
+    unsigned long idx; /* next slot to look at */
+} hashtable_cursor_t;
+
+#define hashtable_cursor_init(c) ((c)->idx = 0)
+
+/*
+ * returns the entry after the cursor and moves the cursor past it, or NULL
+ * once all entries were returned. The slots are scanned in memory order.
+ * The table mustn't change during a walk.
+ */
+void * hashtable_next(hashtable_t *, hashtable_cursor_t *);
+
 void hashtable_free(hashtable_t *);
 void hashtable_destroy(hashtable_t *);
 
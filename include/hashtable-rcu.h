@@ -0,0 +1,120 @@
+#ifndef _LIB_HASHTABLE_RCU_H
+#define _LIB_HASHTABLE_RCU_H
+
+#include "lib/hashtable.h"
+#include <pthread.h>
+
+/*
+ * Read mostly hash table for sharing between threads. It stores the same
+ * entries as the hashtable (starting with HASHTABLE_ENTRY_HEADER, hashed by
+ * the caller) so the umap and uset entries can be kept in it.
+ *
+ * Searches take no locks and write nothing. The table is an array of
+ * pointers to entries that are never changed once published: writers
+ * serialize on a mutex, copy the new entry and publish it, a replacement,
+ * a deletion marker or a whole new table with a single release store.
+ *
+ * Whatever a writer unlinks is retired with the current epoch and only
+ * freed once every registered reader has passed a quiescent state in a
+ * later epoch (quiescent state based RCU). Reader threads register once
+ * and call hashtable_rcu_quiescent whenever they hold no pointers into the
+ * table, e.g. once per request. A reader that goes idle for long should go
+ * offline so it doesn't hold back the freeing.
+ */
+
+#ifndef HASHTABLE_RCU_LOAD_FACTOR
+#define HASHTABLE_RCU_LOAD_FACTOR .5
+#endif
+
+#define HASHTABLE_RCU_MIN_SIZE 16
+
+/*
+ * heads every entry copy and slot array, so retiring them never has to
+ * allocate and a delete can't fail
+ */
+typedef struct _hashtable_rcu_garbage {
+    unsigned long epoch; /* epoch it was unlinked in */
+    struct _hashtable_rcu_garbage * next;
+} hashtable_rcu_garbage_t;
+
+typedef struct {
+    hashtable_rcu_garbage_t garbage; /* first, so freeing it frees the table */
+    unsigned long table_size, /* a power of two */
+                  mask,
+                  used; /* slots holding an entry or a deletion marker */
+    void ** slots; /* entry pointers, allocated right after the struct */
+} hashtable_rcu_table_t;
+
+typedef struct _hashtable_rcu_reader {
+    unsigned long epoch; /* epoch of the last quiescent state, 0 while offline */
+    struct _hashtable_rcu_reader * next;
+} hashtable_rcu_reader_t;
+
+typedef struct {
+    hashtable_rcu_table_t * table; /* NULL until the first insert */
+
+    unsigned long size, /* number of entries */
+                  epoch; /* advanced every time something is retired */
+
+    int entry_size;
+    int (*entry_cmp)(void *, void *, void *); /* entry, entry, state. returns 0 if equal, like strcmp */
+    void * entry_cmp_state;
+    hash_type_t hash_type;
+    hash_seed_t hash_seed;
+
+    pthread_mutex_t write_lock; /* held by writers, readers never take it */
+    hashtable_rcu_reader_t * readers;
+    hashtable_rcu_garbage_t * garbage; /* retired and not yet freed */
+} hashtable_rcu_t;
+
+hashtable_rcu_t * hashtable_rcu_create(int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
+void hashtable_rcu_init(hashtable_rcu_t *, int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
+
+/*
+ * lock free, returns the matching entry or NULL. The entry stays valid
+ * until the calling reader's next quiescent state and must not be changed.
+ */
+void * hashtable_rcu_search(hashtable_rcu_t *, void * /* entry */);
+
+/*
+ * copies the entry into the table, replacing an entry with the same key.
+ * Takes the write lock. Returns 0 and leaves the table as it was when out
+ * of memory, 1 otherwise.
+ */
+int hashtable_rcu_insert(hashtable_rcu_t *, void * /* entry */);
+
+/*
+ * removes the entry with the same key, returns whether there was one.
+ * Takes the write lock.
+ */
+int hashtable_rcu_delete(hashtable_rcu_t *, void * /* entry */);
+
+/*
+ * every thread that searches the table registers as a reader first, the
+ * reader starts out online, NULL when out of memory. Unregistering frees
+ * it.
+ */
+hashtable_rcu_reader_t * hashtable_rcu_register(hashtable_rcu_t *);
+void hashtable_rcu_unregister(hashtable_rcu_t *, hashtable_rcu_reader_t *);
+
+/*
+ * tells the writers the reader holds no entries from earlier searches. A
+ * single plain store to the reader's own epoch.
+ */
+void hashtable_rcu_quiescent(hashtable_rcu_t *, hashtable_rcu_reader_t *);
+
+/*
+ * an offline reader doesn't search and isn't waited for, it has to come
+ * online again before its next search
+ */
+void hashtable_rcu_offline(hashtable_rcu_t *, hashtable_rcu_reader_t *);
+void hashtable_rcu_online(hashtable_rcu_t *, hashtable_rcu_reader_t *);
+
+/*
+ * frees the table, the entries, anything still retired and the readers.
+ * No thread may use the table anymore.
+ */
+void hashtable_rcu_free(hashtable_rcu_t *);
+void hashtable_rcu_destroy(hashtable_rcu_t *);
+
+#endif
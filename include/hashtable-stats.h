@@ -0,0 +1,112 @@
+#ifndef _LIB_HASHTABLE_STATS_H
+#define _LIB_HASHTABLE_STATS_H
+
+/*
+ * Instrumentation shared by the hashtable backends. With HASHTABLE_STATS set
+ * to 1 every table counts how long its lookups probe and how often and for
+ * how long it resizes. Left at 0 the counters aren't part of the table and
+ * the counting macros expand to nothing, so there's no cost at all.
+ *
+ * hashtable_stats works either way, what it reads off the table itself
+ * (load, longest chain, bytes) doesn't need the counters.
+ */
+
+#ifndef HASHTABLE_STATS
+#define HASHTABLE_STATS 0
+#endif
+
+/* probes of HASHTABLE_STATS_HISTOGRAM - 1 steps or more share the last bucket */
+#ifndef HASHTABLE_STATS_HISTOGRAM
+#define HASHTABLE_STATS_HISTOGRAM 32
+#endif
+
+typedef struct {
+    /*
+     * lookups by how far they probed: entries compared in the tree and list
+     * backends, slots in the probe backend, groups in the swiss backend,
+     * buckets in the cuckoo backend (3 when the stash is searched). A
+     * tree lookup during an incremental resize probes both tables and is
+     * counted for each.
+     */
+    unsigned long probe_histogram[HASHTABLE_STATS_HISTOGRAM],
+                  probes, /* sum of the histogram */
+                  max_probe, /* longest probe seen */
+                  resizes; /* resizes of an allocated table, grow or shrink */
+    double resize_secs; /* time spent resizing, incremental steps included */
+} hashtable_counters_t;
+
+typedef struct {
+    hashtable_counters_t counters; /* all 0 without HASHTABLE_STATS */
+
+    unsigned long size,
+                  table_size,
+                  max_chain, /* longest probe any entry in the table needs right now, same unit as the histogram */
+                  bytes; /* same as hashtable_memory_usage */
+    double load_factor; /* size / table_size */
+} hashtable_stats_t;
+
+#if HASHTABLE_STATS
+
+/*
+ * the resize timing uses the POSIX clock_gettime, which a strict -std=c99
+ * build hides. This only works if no system header came before, files
+ * that include one first have to define _POSIX_C_SOURCE themselves.
+ */
+#if defined(__STRICT_ANSI__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <time.h>
+
+/* the counters plus the bookkeeping of a resize in progress, kept in the table */
+#define HASHTABLE_STATS_FIELDS \
+    hashtable_counters_t counters; \
+    struct timespec resize_start; \
+    int resize_depth; /* probes made while resizing aren't lookups */
+
+#define hashtable_count_probe(ht, len) do { \
+        unsigned long _len = (len); \
+        if (!(ht)->resize_depth) { \
+            (ht)->counters.probe_histogram[_len < HASHTABLE_STATS_HISTOGRAM ? _len : HASHTABLE_STATS_HISTOGRAM - 1]++; \
+            (ht)->counters.probes++; \
+            if (_len > (ht)->counters.max_probe) \
+                (ht)->counters.max_probe = _len; \
+        } \
+    } while (0)
+
+#define hashtable_count_resize(ht) ((ht)->counters.resizes++)
+
+/* brackets resize work, nested brackets are timed once */
+#define hashtable_resize_begin(ht) do { \
+        if (!(ht)->resize_depth++) \
+            clock_gettime(CLOCK_MONOTONIC, &(ht)->resize_start); \
+    } while (0)
+
+#define hashtable_resize_end(ht) do { \
+        struct timespec _now; \
+        if (!--(ht)->resize_depth) { \
+            clock_gettime(CLOCK_MONOTONIC, &_now); \
+            (ht)->counters.resize_secs += (_now.tv_sec - (ht)->resize_start.tv_sec) + (_now.tv_nsec - (ht)->resize_start.tv_nsec) / 1e9; \
+        } \
+    } while (0)
+
+#define hashtable_stats_init(ht) do { \
+        memset(&(ht)->counters, 0, sizeof(hashtable_counters_t)); \
+        (ht)->resize_depth = 0; \
+    } while (0)
+
+#define hashtable_stats_counters(ht, stats) ((stats)->counters = (ht)->counters)
+
+#else
+
+#define HASHTABLE_STATS_FIELDS
+#define hashtable_count_probe(ht, len)
+#define hashtable_count_resize(ht)
+#define hashtable_resize_begin(ht)
+#define hashtable_resize_end(ht)
+#define hashtable_stats_init(ht)
+#define hashtable_stats_counters(ht, stats) memset(&(stats)->counters, 0, sizeof(hashtable_counters_t))
+
+#endif
+
+#endif
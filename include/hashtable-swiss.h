@@ -0,0 +1,143 @@
+#ifndef _LIB_HASHTABLE_SWISS_H
+#define _LIB_HASHTABLE_SWISS_H
+
+#include "lib/hash.h"
+#include "lib/hashtable-stats.h"
+
+/*
+ * SwissTable style backend of the hashtable, included through
+ * lib/hashtable.h.
+ *
+ * This backend keeps a separate array of one byte control tags next to the
+ * entries, 7 bits of the hash or an empty/deleted marker. Lookups compare
+ * the tags of 16 slots at once (SSE2 when available) and only touch the
+ * entries whose tag matches, so a lookup is usually one miss in the tags
+ * and one in the entries.
+ */
+
+#ifndef HASHTABLE_LOAD_FACTOR
+#define HASHTABLE_LOAD_FACTOR .875
+#endif
+
+/* use SSE2 for the group matching, otherwise a portable loop is used */
+#ifndef HASHTABLE_SWISS_SSE2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HASHTABLE_SWISS_SSE2 1
+#else
+#define HASHTABLE_SWISS_SSE2 0
+#endif
+#endif
+
+#define HASHTABLE_SWISS_GROUP_WIDTH 16
+
+/* the fields the umap and uset entries start with, tag is their struct tag */
+#define HASHTABLE_ENTRY_HEADER(tag) \
+    int is_occupied; \
+    unsigned long hash;
+
+/* the umap and uset entries need to share the same
+ * memory layout as this struct or BAD things will
+ * happen. The control tags decide if a slot is used,
+ * is_occupied is only kept for the shared layout.
+ */
+typedef struct {
+    int is_occupied;
+    unsigned long hash;
+} hashtable_entry_t;
+
+/* how many entries ahead hashtable_lookup_batch prefetches */
+#ifndef HASHTABLE_PREFETCH_DISTANCE
+#define HASHTABLE_PREFETCH_DISTANCE 16
+#endif
+
+typedef enum {
+    HASHTABLE_LOOKUP_INSERT,
+    HASHTABLE_LOOKUP_SEARCH,
+    HASHTABLE_LOOKUP_DELETE
+} hashtable_lookup_t;
+
+typedef struct {
+    /* array of hash entries */
+    void * table,
+         * entry_cmp_state; /* arbitrary data to pass along to the entry_cmp func */
+
+    unsigned char * ctrl; /* table_size control tags, followed by a copy of the first group */
+
+    unsigned long table_size, /* size of the allocated table, a power of two */
+                  size, /* number of entries in hash table */
+                  mask, /* table_size - 1 */
+                  growth_left; /* inserts into empty slots left before a resize */
+
+    int prime_idx,  /* log2 of the table size */
+        entry_size; /* size of the entries for the hash table */
+    int (*entry_cmp)(void *, void *, void *); /* entry, entry, state. returns 0 if equal, like strcmp */
+    hash_type_t hash_type; /* hash function the entries are keyed with */
+    hash_seed_t hash_seed; /* per table seed for the hash function */
+    HASHTABLE_STATS_FIELDS /* counters, only with HASHTABLE_STATS */
+
+} hashtable_t;
+
+hashtable_t * hashtable_create(int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
+void hashtable_init(hashtable_t *, int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
+
+/*
+ * for HASHTABLE_LOOKUP_DELETE the removed entry is copied into the passed
+ * entry and that is returned.
+ */
+void * hashtable_lookup_entry(hashtable_t *, void * /* entry */, hashtable_lookup_t);
+
+/*
+ * searches for num entries laid out one after another in entries and stores
+ * the matching table entry, or NULL, in results. The home slots are
+ * prefetched HASHTABLE_PREFETCH_DISTANCE entries ahead of the one being
+ * resolved so the cache misses of the batch overlap. Returns the number of
+ * entries found.
+ */
+int hashtable_lookup_batch(hashtable_t *, void * /* entries */, int /* num */, void ** /* results */);
+
+/*
+ * grows the table so count entries fit without another resize. The table
+ * itself is only allocated by the first insert, reserving before that just
+ * picks its size.
+ */
+void hashtable_reserve(hashtable_t *, unsigned long /* count */);
+
+/*
+ * shrinks the table to the smallest size that holds its entries. An empty
+ * table gives back all of its memory until the next insert.
+ */
+void hashtable_shrink_to_fit(hashtable_t *);
+
+void hashtable_print(hashtable_t *);
+
+/*
+ * bytes allocated by the table, the entry arrays plus any overflow nodes.
+ * Doesn't include the hashtable_t itself.
+ */
+unsigned long hashtable_memory_usage(hashtable_t *);
+
+/*
+ * fills in the counters (with HASHTABLE_STATS) and the current shape of the
+ * table, see hashtable-stats.h. Walks the whole table.
+ */
+void hashtable_stats(hashtable_t *, hashtable_stats_t *);
+
+/* position of a walk over the entries, see hashtable_next */
+typedef struct {
+    unsigned long idx; /* next slot to look at */
+} hashtable_cursor_t;
+
+#define hashtable_cursor_init(c) ((c)->idx = 0)
+
+/*
+ * returns the entry after the cursor and moves the cursor past it, or NULL
+ * once all entries were returned. The slots are scanned in memory order,
+ * reading only the control tags of empty slots. The table mustn't change
+ * during a walk.
+ */
+void * hashtable_next(hashtable_t *, hashtable_cursor_t *);
+
+void hashtable_free(hashtable_t *);
+void hashtable_destroy(hashtable_t *);
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef _LIB_HASHTABLE_TREE_H
+#define _LIB_HASHTABLE_TREE_H
+
+#include "lib/hash.h"
+#include "lib/hashtable-stats.h"
+
+/*
+ * Tree backend of the hashtable, included through lib/hashtable.h. Each
+ * bucket of the prime sized table holds a binary tree (ordered by hash) of
+ * the entries that collide there.
+ */
+
+#ifndef HASHTABLE_LOAD_FACTOR
+#define HASHTABLE_LOAD_FACTOR .8
+#endif
+
+#ifndef HASHTABLE_PROBE_LINEAR
+#define HASHTABLE_PROBE_LINEAR 1
+#endif
+
+/*
+ * resize incrementally: the old table is kept next to the new one and a few
+ * of its buckets are moved on every lookup, instead of reinserting every
+ * entry inside the one insert that crossed the load factor.
+ */
+#ifndef HASHTABLE_INCREMENTAL_RESIZE
+#define HASHTABLE_INCREMENTAL_RESIZE 1
+#endif
+
+/* old buckets migrated per lookup while a resize is in progress */
+#ifndef HASHTABLE_MIGRATE_STEP
+#define HASHTABLE_MIGRATE_STEP 4
+#endif
+
+/* the fields the umap and uset entries start with, tag is their struct tag */
+#define HASHTABLE_ENTRY_HEADER(tag) \
+    int is_occupied; \
+    unsigned long hash; \
+    struct tag * left, \
+               * right, \
+               * next;
+
+/* the umap and uset entries need to share the same
+ * memory layout as this struct or BAD things will
+ * happen
+ */
+typedef struct _hashtable_entry {
+    int is_occupied;
+    unsigned long hash;
+    struct _hashtable_entry * left,
+                            * right,
+                            * next;
+} hashtable_entry_t;
+
+/*
+ * overflow nodes are carved out of slabs owned by the table. The first slab
+ * holds HASHTABLE_SLAB_MIN_NODES nodes, each one after that doubles up to
+ * HASHTABLE_SLAB_MAX_NODES.
+ */
+#ifndef HASHTABLE_SLAB_MIN_NODES
+#define HASHTABLE_SLAB_MIN_NODES 16
+#endif
+
+#ifndef HASHTABLE_SLAB_MAX_NODES
+#define HASHTABLE_SLAB_MAX_NODES 4096
+#endif
+
+typedef struct _hashtable_slab {
+    struct _hashtable_slab * next;
+    unsigned long num_nodes, /* nodes the slab holds */
+                  used; /* nodes handed out so far */
+} hashtable_slab_t; /* the nodes follow the header */
+
+/* how many entries ahead hashtable_lookup_batch prefetches */
+#ifndef HASHTABLE_PREFETCH_DISTANCE
+#define HASHTABLE_PREFETCH_DISTANCE 16
+#endif
+
+typedef enum {
+    HASHTABLE_LOOKUP_INSERT,
+    HASHTABLE_LOOKUP_SEARCH,
+    HASHTABLE_LOOKUP_DELETE
+} hashtable_lookup_t;
+
+typedef struct {
+    /* array of hash entries */
+    void * table,
+         * entry_cmp_state; /* arbitrary data to pass along to the entry_cmp func */
+    
+    void * old_table; /* table being migrated during an incremental resize, NULL otherwise */
+    
+    hashtable_slab_t * slabs, /* newest slab first */
+                     * retired_slabs; /* slabs being emptied by a shrink */
+    hashtable_entry_t * free_nodes; /* overflow nodes given back, linked through next */
+    
+    unsigned long table_size, /* size of the allocated table */
+                  size, /* number of entries in hash table */
+                  old_table_size, /* size of the old table */
+                  migrate_idx, /* old buckets below this have been moved */
+                  slab_bytes; /* bytes allocated for slabs */
+    
+    int prime_idx,  /* index into the prime doubles array */
+        entry_size; /* size of the entries for the hash table */
+    int (*entry_cmp)(void *, void *, void *); /* entry, entry, state. returns 0 if equal, like strcmp */
+    hash_type_t hash_type; /* hash function the entries are keyed with */
+    hash_seed_t hash_seed; /* per table seed for the hash function */
+    HASHTABLE_STATS_FIELDS /* counters, only with HASHTABLE_STATS */
+
+} hashtable_t;
+
+hashtable_t * hashtable_create(int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
+void hashtable_init(hashtable_t *, int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */, hash_type_t, hash_seed_t * /* NULL for a random seed */);
+
+/*
+ * for HASHTABLE_LOOKUP_DELETE the removed entry is copied into the passed
+ * entry and that is returned.
+ */
+void * hashtable_lookup_entry(hashtable_t *, void * /* entry */, hashtable_lookup_t);
+
+/*
+ * searches for num entries laid out one after another in entries and stores
+ * the matching table entry, or NULL, in results. The home slots are
+ * prefetched HASHTABLE_PREFETCH_DISTANCE entries ahead of the one being
+ * resolved so the cache misses of the batch overlap. Returns the number of
+ * entries found.
+ */
+int hashtable_lookup_batch(hashtable_t *, void * /* entries */, int /* num */, void ** /* results */);
+
+/*
+ * grows the table so count entries fit without another resize. The table
+ * itself is only allocated by the first insert, reserving before that just
+ * picks its size.
+ */
+void hashtable_reserve(hashtable_t *, unsigned long /* count */);
+
+/*
+ * shrinks the table to the smallest size that holds its entries. An empty
+ * table gives back all of its memory until the next insert.
+ */
+void hashtable_shrink_to_fit(hashtable_t *);
+
+void hashtable_print(hashtable_t *);
+
+/*
+ * bytes allocated by the table, the entry arrays plus any overflow nodes.
+ * Doesn't include the hashtable_t itself.
+ */
+unsigned long hashtable_memory_usage(hashtable_t *);
+
+/*
+ * fills in the counters (with HASHTABLE_STATS) and the current shape of the
+ * table, see hashtable-stats.h. Walks the whole table.
+ */
+void hashtable_stats(hashtable_t *, hashtable_stats_t *);
+
+/* position of a walk over the entries, see hashtable_next */
+typedef struct {
+    unsigned long idx; /* next bucket to look at */
+    hashtable_entry_t * node; /* next overflow node of the bucket before idx */
+} hashtable_cursor_t;
+
+#define hashtable_cursor_init(c) ((c)->idx = 0, (c)->node = NULL)
+
+/*
+ * returns the entry after the cursor and moves the cursor past it, or NULL
+ * once all entries were returned. Buckets are visited in the order they
+ * sit in the table, each followed by its overflow nodes, and the buckets
+ * of a table being migrated come last. The table mustn't change during a
+ * walk.
+ */
+void * hashtable_next(hashtable_t *, hashtable_cursor_t *);
+
+void hashtable_free(hashtable_t *);
+void hashtable_destroy(hashtable_t *);
+
+#endif
@@ -2,58 +2,53 @@
 #define _LIB_HASHTABLE_H
 
 /*
- * The hashtable is an internal use only data structure used to implement the 
- * umap and uset.
+ * The hashtable is an internal use only data structure used to implement the
+ * umap and uset. It has several implementations behind the same api, the
+ * one used is picked for the whole build with HASHTABLE_BACKEND:
+ *
+ *  - HASHTABLE_BACKEND_TREE, prime sized buckets with the collisions kept in
+ *    a binary tree of overflow nodes, resized incrementally (the default)
+ *  - HASHTABLE_BACKEND_LIST, prime sized buckets with overflow lists
+ *  - HASHTABLE_BACKEND_PROBE, open addressing with linear or robin hood
+ *    probing
+ *  - HASHTABLE_BACKEND_SWISS, open addressing over groups of 16 one byte
+ *    control tags
+ *  - HASHTABLE_BACKEND_CUCKOO, bucketized cuckoo hashing, every lookup reads
+ *    at most two buckets and a small stash
+ *
+ *     cc -DHASHTABLE_BACKEND=HASHTABLE_BACKEND_SWISS ...
+ *
+ * Only the source of the picked backend compiles to anything, so all of
+ * src/hashtable-*.c can be built every time.
  */
 
-#ifndef HASHTABLE_LOAD_FACTOR
-#define HASHTABLE_LOAD_FACTOR .8
-#endif
+#define HASHTABLE_BACKEND_TREE   1
+#define HASHTABLE_BACKEND_LIST   2
+#define HASHTABLE_BACKEND_PROBE  3
+#define HASHTABLE_BACKEND_SWISS  4
+#define HASHTABLE_BACKEND_CUCKOO 5
 
-#ifndef HASHTABLE_PROBE_LINEAR
-#define HASHTABLE_PROBE_LINEAR 1
+#ifndef HASHTABLE_BACKEND
+#define HASHTABLE_BACKEND HASHTABLE_BACKEND_TREE
 #endif
 
-/* the umap and uset entries need to share the same
- * memory layout as this struct or BAD things will
- * happen
- */
-typedef struct _hashtable_entry {
-    int is_occupied;
-    unsigned long hash;
-    struct _hashtable_entry * left,
-                            * right,
-                            * next;
-} hashtable_entry_t;
-
-typedef enum {
-    HASHTABLE_LOOKUP_INSERT,
-    HASHTABLE_LOOKUP_SEARCH,
-    HASHTABLE_LOOKUP_DELETE
-} hashtable_lookup_t;
-
-typedef struct {
-    /* array of hash entries */
-    void * table,
-         * entry_cmp_state; /* arbitrary data to pass along to the entry_cmp func */
-    
-    unsigned long table_size, /* size of the allocated table */
-                  size; /* number of entries in hash table */
-    
-    int prime_idx,  /* index into the prime doubles array */
-        entry_size; /* size of the entries for the hash table */
-    int (*entry_cmp)(void *, void *, void *); /* entry, entry, state */
-
-} hashtable_t;
-
-hashtable_t * hashtable_create(int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */);
-void hashtable_init(hashtable_t *, int /* entry size */, int (*)(void *, void *, void *) /* entry comp */, void * /* entry cmp state */);
-
-void * hashtable_lookup_entry(hashtable_t *, void * /* entry */, hashtable_lookup_t);
-
-void hashtable_print(hashtable_t *);
-
-void hashtable_free(hashtable_t *);
-void hashtable_destroy(hashtable_t *);
+#if HASHTABLE_BACKEND == HASHTABLE_BACKEND_TREE
+#define HASHTABLE_BACKEND_NAME "tree"
+#include "lib/hashtable-tree.h"
+#elif HASHTABLE_BACKEND == HASHTABLE_BACKEND_LIST
+#define HASHTABLE_BACKEND_NAME "list"
+#include "lib/hashtable-list.h"
+#elif HASHTABLE_BACKEND == HASHTABLE_BACKEND_PROBE
+#define HASHTABLE_BACKEND_NAME "probe"
+#include "lib/hashtable-probe.h"
+#elif HASHTABLE_BACKEND == HASHTABLE_BACKEND_SWISS
+#define HASHTABLE_BACKEND_NAME "swiss"
+#include "lib/hashtable-swiss.h"
+#elif HASHTABLE_BACKEND == HASHTABLE_BACKEND_CUCKOO
+#define HASHTABLE_BACKEND_NAME "cuckoo"
+#include "lib/hashtable-cuckoo.h"
+#else
+#error "unknown HASHTABLE_BACKEND"
+#endif
 
 #endif
@@ -0,0 +1,86 @@
+#ifndef _LIB_KEY_ARENA_H
+#define _LIB_KEY_ARENA_H
+
+#include <stdint.h>
+
+/*
+ * Bump allocator for the string keys a umap or uset owns.
+ *
+ * Each key is copied to the end of the current block, after its length as
+ * a 32 bit prefix and followed by a '\0', so the keys that are added
+ * together sit next to each other. Blocks start at KEY_ARENA_MIN_BLOCK
+ * bytes and double up to KEY_ARENA_MAX_BLOCK. A key is never moved once it
+ * is in a block, and a deleted key only counts as dead until the owner
+ * compacts the arena by copying the live keys into a new one.
+ */
+
+#ifndef KEY_ARENA_MIN_BLOCK
+#define KEY_ARENA_MIN_BLOCK 4096
+#endif
+
+#ifndef KEY_ARENA_MAX_BLOCK
+#define KEY_ARENA_MAX_BLOCK (1 << 20)
+#endif
+
+/* fraction of the bytes in use that are dead when compacting pays off */
+#ifndef KEY_ARENA_COMPACT_RATIO
+#define KEY_ARENA_COMPACT_RATIO .5
+#endif
+
+/* dead bytes below which the arena is never worth compacting */
+#ifndef KEY_ARENA_COMPACT_MIN
+#define KEY_ARENA_COMPACT_MIN 4096
+#endif
+
+typedef struct _key_arena_block {
+    struct _key_arena_block * next;
+    unsigned long size, /* bytes for keys */
+                  used;
+} key_arena_block_t; /* the keys follow the header */
+
+typedef struct {
+    key_arena_block_t * blocks; /* newest first, NULL until the first key */
+
+    unsigned long used, /* bytes taken by keys, live or dead */
+                  dead, /* bytes taken by deleted keys */
+                  allocated; /* bytes of all blocks, headers included */
+} key_arena_t;
+
+/* length of a key in the arena, read from its prefix */
+#define key_arena_len(key) (((uint32_t *) (key))[-1])
+
+void key_arena_init(key_arena_t *);
+
+/*
+ * copies len bytes of str into the arena and returns the copy, which is
+ * '\0' terminated. NULL when out of memory.
+ */
+char * key_arena_push(key_arena_t *, const char * str, int len);
+
+/*
+ * marks a key returned by key_arena_push as dead, its bytes come back when
+ * the arena is compacted or freed
+ */
+void key_arena_release(key_arena_t *, char * key);
+
+/*
+ * makes sure the next bytes worth of keys fit in one block, used to give a
+ * compacted arena a single block. Returns 0 when out of memory.
+ */
+int key_arena_reserve(key_arena_t *, unsigned long bytes);
+
+/*
+ * true once enough of the arena is dead that the owner should compact it
+ */
+#define key_arena_should_compact(a) \
+    ((a)->dead >= KEY_ARENA_COMPACT_MIN && (a)->dead >= (a)->used * KEY_ARENA_COMPACT_RATIO)
+
+/* bytes of the keys still in use */
+#define key_arena_live(a) ((a)->used - (a)->dead)
+
+/*
+ * frees every block at once, the arena is empty again afterwards
+ */
+void key_arena_free(key_arena_t *);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef _LIB_UMAP_CONCURRENT_H
+#define _LIB_UMAP_CONCURRENT_H
+
+#include "lib/umap.h"
+#include <pthread.h>
+
+/*
+ * Unordered map that can be shared between threads. The key space is
+ * striped over independent hash tables (shards), each with its own lock and
+ * its own resizing, so threads only wait on each other when they hit the
+ * same shard and a resize only stalls the users of one shard.
+ *
+ * The key and value types are set with the umap_key_t_* and umap_val_t_*
+ * macros, before anything is added.
+ */
+
+#ifndef UMAP_CONCURRENT_SHARDS
+#define UMAP_CONCURRENT_SHARDS 64
+#endif
+
+typedef struct {
+    hashtable_t ht;
+    pthread_mutex_t lock;
+} umap_shard_t;
+
+typedef struct {
+    umap_shard_t * shards;
+    int num_shards;
+
+    umap_key_type_t key_type;
+    umap_val_type_t val_type;
+    hash_type_t hash_type; /* all shards hash with the same function and seed */
+    hash_seed_t hash_seed;
+} umap_concurrent_t;
+
+/*
+ * num_shards of 0 uses UMAP_CONCURRENT_SHARDS. A few times the number of
+ * threads keeps the chance of two threads hitting the same shard low.
+ * umap_concurrent_create returns NULL and umap_concurrent_init returns 0
+ * when out of memory, there is nothing to free then.
+ */
+umap_concurrent_t * umap_concurrent_create(int /* num shards */);
+int umap_concurrent_init(umap_concurrent_t *, int /* num shards */);
+
+/*
+ * same parameters as umap_add and umap_get, and safe to call from any
+ * thread. The value is copied out while the shard is locked.
+ */
+void umap_concurrent_add(umap_concurrent_t *, ...);
+int umap_concurrent_get(umap_concurrent_t *, ...);
+
+/*
+ * number of entries over all the shards
+ */
+unsigned long umap_concurrent_size(umap_concurrent_t *);
+
+void umap_concurrent_free(umap_concurrent_t *);
+void umap_concurrent_destroy(umap_concurrent_t *);
+
+#endif
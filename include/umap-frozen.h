@@ -0,0 +1,90 @@
+#ifndef _LIB_UMAP_FROZEN_H
+#define _LIB_UMAP_FROZEN_H
+
+#include "lib/umap.h"
+#include <stdint.h>
+
+/*
+ * Read only copy of a umap, built once for lookup tables that never change
+ * after startup.
+ *
+ * The keys are placed with a minimal perfect hash in the style of CHD
+ * (hash and displace): every key hashes to one of num_buckets buckets, and
+ * each bucket stores the displacement that moves its keys into free slots.
+ * A lookup computes the one slot its key can be in and compares that entry,
+ * there is no probing, and the entry array holds exactly size entries.
+ *
+ * The displacements are searched over UMAP_FROZEN_LOAD_FACTOR more slots
+ * than there are keys, so the last buckets still find a free slot quickly.
+ * The few keys that land past the end are sent to the holes that are left
+ * through a small remap array.
+ */
+
+/* keys per bucket on average, fewer costs more displacements but builds faster */
+#ifndef UMAP_FROZEN_BUCKET_SIZE
+#define UMAP_FROZEN_BUCKET_SIZE 4
+#endif
+
+/* keys / slots while placing the keys */
+#ifndef UMAP_FROZEN_LOAD_FACTOR
+#define UMAP_FROZEN_LOAD_FACTOR .99
+#endif
+
+/* salts tried before giving up, only keys with the same hash need more than one */
+#define UMAP_FROZEN_MAX_SALTS 16
+
+typedef struct {
+    unsigned long hash;
+    int key_len;
+    union _umap_datum key,
+                      value;
+} umap_frozen_entry_t;
+
+typedef struct {
+    umap_frozen_entry_t * entries; /* size entries in perfect hash order */
+    uint16_t * disp; /* displacement of each bucket */
+    uint32_t * remap; /* entry of each slot past size */
+
+    unsigned long size,
+                  num_slots, /* slots the displacements place keys in, size and up */
+                  num_buckets;
+    uint64_t salt;
+
+    umap_key_type_t key_type;
+    umap_val_type_t val_type;
+    hash_type_t hash_type;
+    hash_seed_t hash_seed;
+
+    key_arena_t keys; /* copies of the string keys the umap owned */
+} umap_frozen_t;
+
+/*
+ * builds the frozen copy of the map. The umap is left as it is. String
+ * keys the caller owns are shared with it, keys the umap owns (see
+ * umap_own_keys) are copied since the umap moves them when it compacts
+ * its key arena. Returns NULL when out of memory or if no perfect hash
+ * was found, which only happens when different keys have the same hash.
+ */
+umap_frozen_t * umap_freeze(umap_t *);
+
+/*
+ * same parameters as umap_get
+ */
+int umap_frozen_get(umap_frozen_t *, ...);
+
+#define umap_frozen_size(m) ((m)->size)
+
+/*
+ * bytes allocated by the frozen map, the entries plus the perfect hash and
+ * any copied keys
+ */
+unsigned long umap_frozen_memory_usage(umap_frozen_t *);
+
+/*
+ * bits per key of the perfect hash alone, displacements and remap array
+ */
+double umap_frozen_bits_per_key(umap_frozen_t *);
+
+void umap_frozen_destroy(umap_frozen_t *);
+
+#endif
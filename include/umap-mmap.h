@@ -0,0 +1,92 @@
+#ifndef _LIB_UMAP_MMAP_H
+#define _LIB_UMAP_MMAP_H
+
+#include "lib/umap.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Saved umap images that are opened with mmap instead of being rebuilt.
+ *
+ * umap_save writes the map as a read only open addressing table: a header,
+ * an array of fixed size slots and a blob holding the string keys. Nothing
+ * in the file is a pointer, string keys are offsets into the blob, so the
+ * image works wherever it's mapped. umap_open_mmap maps the file, checks
+ * the header and is done, the lookups run straight against the page cache
+ * and pull in only the pages they touch.
+ *
+ * The image keeps the hash function and seed of the map, and is only read
+ * back on machines with the same byte order and unsigned long size. Only
+ * maps with int or double values can be saved, data pointers mean nothing
+ * to another process.
+ */
+
+#define UMAP_FILE_MAGIC     "umapimg"
+#define UMAP_FILE_VERSION   1
+#define UMAP_FILE_BYTE_ORDER 0x01020304 /* reads back differently on the other byte order */
+
+/* highest share of slots a saved table fills, keeps the probes short */
+#define UMAP_FILE_LOAD_FACTOR .5
+
+/* the header at the start of the file */
+typedef struct {
+    char magic[8];
+    uint32_t version,
+             byte_order,
+             hash_bits, /* bits in an unsigned long where the file was written */
+             key_type, /* umap_key_type_t */
+             val_type, /* umap_val_type_t */
+             hash_type; /* hash_type_t */
+    uint64_t hash_k0, /* the hash seed */
+             hash_k1,
+             size, /* number of entries */
+             num_slots, /* a power of two */
+             slots_off, /* offset of the slot array from the start of the file */
+             blob_off, /* offset of the string blob */
+             blob_size,
+             file_size;
+} umap_file_header_t;
+
+typedef struct {
+    uint64_t hash,
+             key, /* int or double bits, or the offset of a string key in the blob */
+             value; /* int or double bits */
+    uint32_t key_len, /* length of string keys, the blob also has a terminating 0 */
+             is_occupied;
+} umap_file_slot_t;
+
+typedef struct {
+    void * base; /* the mapping */
+    size_t len;
+
+    const umap_file_header_t * header;
+    const umap_file_slot_t * slots;
+    const char * blob;
+    uint64_t mask; /* num_slots - 1 */
+    hash_seed_t hash_seed;
+} umap_mmap_t;
+
+/*
+ * writes the map to path, through a temporary file that is renamed over
+ * path once complete. Returns 0, or -1 with errno set (EINVAL for maps with
+ * data values).
+ */
+int umap_save(umap_t *, const char * /* path */);
+
+/*
+ * maps a file written by umap_save. Returns NULL with errno set if the file
+ * can't be opened or isn't a valid image (EINVAL).
+ */
+umap_mmap_t * umap_open_mmap(const char * /* path */);
+
+/*
+ * same parameters as umap_get, the key is of the type the map was saved
+ * with
+ */
+int umap_mmap_get(umap_mmap_t *, ...);
+
+#define umap_mmap_size(m) ((m)->header->size)
+
+void umap_mmap_close(umap_mmap_t *);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef _LIB_UMAP_ORDERED_H
+#define _LIB_UMAP_ORDERED_H
+
+#include "lib/umap.h"
+#include "lib/vector.h"
+
+#include <stdint.h>
+
+/*
+ * Unordered map that remembers the order its keys were added in, laid out
+ * like the compact dicts of Python. The entries are appended to a dense
+ * vector and the index is an open addressed array of 32 bit positions in
+ * it, linear probing with the hashes and keys compared through the vector.
+ * So
+ *
+ *  - a resize rebuilds the index, 4 bytes a slot, and never copies an entry
+ *  - iterating is a scan of the vector, in insertion order
+ *  - an entry keeps its position for as long as it's in the map
+ *
+ * Entry pointers stay valid until the vector grows, umap_ordered_reserve
+ * up front keeps them valid for that many entries. Deleted entries leave a
+ * hole behind that iteration skips, umap_ordered_shrink_to_fit closes the
+ * holes (and moves the entries).
+ *
+ * The key and value types are set with the umap_key_t_* and umap_val_t_*
+ * macros, before anything is added.
+ */
+
+/* occupied / slots of the index before it doubles */
+#ifndef UMAP_ORDERED_LOAD_FACTOR
+#define UMAP_ORDERED_LOAD_FACTOR .75
+#endif
+
+/* slots of the first index, a power of two */
+#define UMAP_ORDERED_MIN_SLOTS 8
+
+typedef struct {
+    uint32_t * index; /* position + 1 of an entry in the vector, 0 for an empty slot */
+    unsigned long num_slots; /* power of two, 0 until the first add */
+    vector_t entries; /* of umap_entry_t, is_occupied is 0 for a deleted entry */
+
+    unsigned int size; /* entries not deleted, and occupied slots */
+
+    umap_key_type_t key_type;
+    umap_val_type_t val_type;
+    hash_type_t hash_type;
+    hash_seed_t hash_seed;
+} umap_ordered_t;
+
+umap_ordered_t * umap_ordered_create();
+void umap_ordered_init(umap_ordered_t *);
+
+/*
+ * same parameters as umap_add and umap_get. Adding a key that is already
+ * in the map changes its value and keeps its position.
+ */
+void umap_ordered_add(umap_ordered_t *, ...);
+int umap_ordered_get(umap_ordered_t *, ...);
+
+/*
+ * takes the umap and a key, returns the entry of the key or NULL
+ */
+umap_entry_t * umap_ordered_find(umap_ordered_t *, ...);
+
+/*
+ * removes the key, returns whether it was in the map
+ */
+int umap_ordered_del(umap_ordered_t *, ...);
+
+/*
+ * returns the first entry at or after *pos and moves *pos past it, or NULL
+ * once all entries were seen. Start with *pos at 0:
+ *
+ *     unsigned int pos;
+ *     umap_entry_t * e;
+ *
+ *     umap_ordered_foreach(map, pos, e)
+ *         printf("%d\n", e->value.i);
+ */
+umap_entry_t * umap_ordered_next(umap_ordered_t *, unsigned int * /* pos */);
+
+#define umap_ordered_foreach(m, pos, e) \
+    for ((pos) = 0; ((e) = umap_ordered_next(m, &(pos))) != NULL; )
+
+#define umap_ordered_size(m) (m)->size
+
+/*
+ * makes room for count entries up front, so adding them never resizes the
+ * index or moves the entries
+ */
+void umap_ordered_reserve(umap_ordered_t *, unsigned long /* count */);
+
+/*
+ * closes the holes left by deleted entries, which moves the entries after
+ * them, and shrinks the index and the vector to fit
+ */
+void umap_ordered_shrink_to_fit(umap_ordered_t *);
+
+/*
+ * bytes allocated by the umap, the index plus the vector of entries
+ */
+unsigned long umap_ordered_memory_usage(umap_ordered_t *);
+
+void umap_ordered_free(umap_ordered_t *);
+void umap_ordered_destroy(umap_ordered_t *);
+
+#endif
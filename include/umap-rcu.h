@@ -0,0 +1,63 @@
+#ifndef _LIB_UMAP_RCU_H
+#define _LIB_UMAP_RCU_H
+
+#include "lib/umap.h"
+#include "lib/hashtable-rcu.h"
+
+/*
+ * Unordered map for data that is read by many threads and changed rarely,
+ * like configuration or routing tables. umap_rcu_get takes no locks and
+ * does no atomic writes, adds and deletes serialize on a lock and publish
+ * their changes so the readers never wait (see hashtable-rcu.h).
+ *
+ * Each thread that calls umap_rcu_get registers a reader and reports a
+ * quiescent state every now and then, between gets, so the old entries
+ * and tables can be freed:
+ *
+ *     umap_rcu_reader_t * r = umap_rcu_register(map);
+ *     while (serving) {
+ *         umap_rcu_get(map, key, &val);
+ *         ...
+ *         umap_rcu_quiescent(map, r);
+ *     }
+ *     umap_rcu_unregister(map, r);
+ *
+ * The key and value types are set with the umap_key_t_* and umap_val_t_*
+ * macros, before anything is added.
+ */
+
+typedef hashtable_rcu_reader_t umap_rcu_reader_t;
+
+typedef struct {
+    hashtable_rcu_t ht;
+
+    umap_key_type_t key_type;
+    umap_val_type_t val_type;
+} umap_rcu_t;
+
+umap_rcu_t * umap_rcu_create();
+void umap_rcu_init(umap_rcu_t *);
+
+/*
+ * same parameters as umap_add and umap_get. umap_rcu_add returns 0 and
+ * leaves the map as it was when out of memory. umap_rcu_get copies the
+ * value out, nothing it returns depends on the entry staying alive.
+ */
+int umap_rcu_add(umap_rcu_t *, ...);
+int umap_rcu_get(umap_rcu_t *, ...);
+
+/*
+ * removes the key, returns whether it was in the map
+ */
+int umap_rcu_del(umap_rcu_t *, ...);
+
+umap_rcu_reader_t * umap_rcu_register(umap_rcu_t *);
+void umap_rcu_unregister(umap_rcu_t *, umap_rcu_reader_t *);
+void umap_rcu_quiescent(umap_rcu_t *, umap_rcu_reader_t *);
+void umap_rcu_offline(umap_rcu_t *, umap_rcu_reader_t *);
+void umap_rcu_online(umap_rcu_t *, umap_rcu_reader_t *);
+
+void umap_rcu_free(umap_rcu_t *);
+void umap_rcu_destroy(umap_rcu_t *);
+
+#endif
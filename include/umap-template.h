@@ -0,0 +1,363 @@
+#ifndef _LIB_UMAP_TEMPLATE_H
+#define _LIB_UMAP_TEMPLATE_H
+
+#include "lib/hash.h"
+#include "lib/hashtable-probe-core.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Typed hash maps generated by macros, in the style of khash.
+ *
+ * The generic umap keeps keys and values in a union _umap_datum and
+ * compares keys through the entry_cmp callback, so the compiler can't
+ * inline anything and a struct value has to be boxed behind a pointer.
+ * UMAP_DECLARE generates a table for one key and value type instead. The
+ * hash and the key comparison are expanded in place and the entries are
+ * { key_t key; val_t value; } at their natural size.
+ *
+ *     typedef struct { double x, y; } point_t;
+ *
+ *     UMAP_DECLARE(points, int, point_t, umap_template_int_hash, umap_template_int_eq)
+ *
+ *     points_t m;
+ *     point_t p = { 1, 2 };
+ *
+ *     points_init(&m);
+ *     points_put(&m, 7, p);
+ *     points_get(&m, 7)->x += 1;
+ *
+ * The tables probe like the probe backend with its default options (power
+ * of two sizes, robin hood, metadata in its own array) and run the same
+ * HASHTABLE_PROBE_CORE. They don't keep the full hash of an entry, so a
+ * resize hashes the keys again.
+ *
+ * hash_fn(key) returns an unsigned long whose low bits pick the slot, so it
+ * needs to be well mixed. eq_fn(a, b) returns nonzero if the keys are
+ * equal. Either can be a macro. There is no per table seed, use a keyed
+ * hash in hash_fn for keys that come from untrusted input.
+ *
+ * UMAP_DECLARE makes all functions static inline, for a table used in one
+ * file. To share a table between files put UMAP_DECLARE_EXTERN in a header
+ * and UMAP_DEFINE in one .c file.
+ *
+ * For a table called name this generates
+ *
+ *  name_t, name_entry_t
+ *  void name_init(name_t *)
+ *  void name_free(name_t *)
+ *  val_t * name_put(name_t *, key_t, val_t)
+ *  val_t * name_get(name_t *, key_t)
+ *  int name_del(name_t *, key_t, val_t * ret)
+ *  int name_reserve(name_t *, unsigned long count)
+ *  unsigned long name_size(name_t *)
+ *  unsigned long name_memory_usage(name_t *)
+ *  name_entry_t * name_next(name_t *, unsigned long * pos)
+ *
+ * plus helpers starting with name_core_ that aren't part of the interface.
+ */
+
+#ifndef UMAP_TEMPLATE_LOAD_FACTOR
+#define UMAP_TEMPLATE_LOAD_FACTOR .9
+#endif
+
+/* slots of the first table, a power of two */
+#define UMAP_TEMPLATE_MIN_SIZE 8
+
+/* accessors for HASHTABLE_PROBE_CORE, the same for every generated table */
+#define umap_template_home_idx(m, hash)         ((hash) & (m)->mask)
+#define umap_template_next_idx(m, idx)          (((idx) + 1) & (m)->mask)
+#define umap_template_prev_idx(m, idx)          (((idx) - 1) & (m)->mask)
+#define umap_template_slot_dist(m, idx)         ((m)->meta[idx].dist)
+#define umap_template_slot_match(m, idx, fp)    ((m)->meta[idx].fingerprint == (fp))
+#define umap_template_move_slot(m, dst, src)    ((m)->entries[dst] = (m)->entries[src], (m)->meta[dst] = (m)->meta[src])
+#define umap_template_count_probe(m, len)
+
+/* hash and eq functions for int and string keys */
+#define umap_template_int_eq(a, b)  ((a) == (b))
+#define umap_template_str_hash(s)   hash_murmur_str(s)
+#define umap_template_str_eq(a, b)  (strcmp(a, b) == 0)
+
+/*
+ * the splitmix64 finalizer, the mixer hash_int uses, here so it can be
+ * inlined
+ */
+static inline unsigned long umap_template_int_hash(unsigned long long x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+
+    return (unsigned long) x;
+}
+
+/*
+ * number of entries that trigger a resize of a table of the given size,
+ * there is always an empty slot left to end the probe runs
+ */
+static inline unsigned long umap_template_capacity(unsigned long table_size)
+{
+    unsigned long resize_at = table_size * UMAP_TEMPLATE_LOAD_FACTOR;
+
+    return resize_at >= table_size ? table_size - 1 : resize_at;
+}
+
+#define UMAP_TYPE(name, key_t, val_t) \
+    typedef struct { \
+        key_t key; \
+        val_t value; \
+    } name##_entry_t; \
+    \
+    typedef struct { \
+        name##_entry_t * entries; \
+        hashtable_probe_meta_t * meta; /* NULL like entries until the first put */ \
+        \
+        unsigned long size, /* number of entries */ \
+                      mask, /* table size - 1 */ \
+                      resize_at; /* size that triggers the next resize, 0 before the first put */ \
+    } name##_t;
+
+#define UMAP_PROTOTYPES(scope, name, key_t, val_t) \
+    scope void name##_init(name##_t *); \
+    scope void name##_free(name##_t *); \
+    scope val_t * name##_put(name##_t *, key_t, val_t); \
+    scope val_t * name##_get(name##_t *, key_t); \
+    scope int name##_del(name##_t *, key_t, val_t *); \
+    scope int name##_reserve(name##_t *, unsigned long); \
+    scope unsigned long name##_size(name##_t *); \
+    scope unsigned long name##_memory_usage(name##_t *); \
+    scope name##_entry_t * name##_next(name##_t *, unsigned long *);
+
+#define UMAP_FUNCS(scope, name, key_t, val_t, hash_fn, eq_fn) \
+    static inline int name##_core_key_match(name##_t * this, unsigned long idx, key_t key) \
+    { \
+        return eq_fn(this->entries[idx].key, key); \
+    } \
+    \
+    /* name_core_probe, name_core_shift and name_core_remove */ \
+    HASHTABLE_PROBE_CORE(static inline, name##_core, name##_t, key_t, 1, \
+        umap_template_home_idx, umap_template_next_idx, umap_template_prev_idx, umap_template_slot_dist, \
+        umap_template_slot_match, name##_core_key_match, umap_template_move_slot, umap_template_count_probe) \
+    \
+    /* \
+     * makes room at idx, where name_core_probe said the key goes, and \
+     * returns the entry there for the caller to fill in \
+     */ \
+    static inline name##_entry_t * name##_core_place(name##_t * this, unsigned long idx, unsigned long hash, int dist) \
+    { \
+        name##_core_shift(this, idx); \
+        \
+        this->meta[idx].fingerprint = hashtable_probe_fingerprint(hash); \
+        this->meta[idx].dist        = dist + 1; \
+        \
+        return &this->entries[idx]; \
+    } \
+    \
+    /* \
+     * moves the entries into a table of table_size slots. Returns 0 and \
+     * keeps the old table when out of memory. \
+     */ \
+    static inline int name##_core_resize(name##_t * this, unsigned long table_size) \
+    { \
+        name##_entry_t * old_entries = this->entries; \
+        hashtable_probe_meta_t * old_meta = this->meta; \
+        unsigned long old_table_size = old_entries ? this->mask + 1 : 0, \
+                      hash, \
+                      i, \
+                      idx; \
+        int dist, found; \
+        \
+        this->entries   = malloc(table_size * sizeof(name##_entry_t)); \
+        this->meta      = calloc(table_size, sizeof(hashtable_probe_meta_t)); \
+        \
+        if (!this->entries || !this->meta) \
+        { \
+            free(this->entries); \
+            free(this->meta); \
+            \
+            this->entries   = old_entries; \
+            this->meta      = old_meta; \
+            return 0; \
+        } \
+        \
+        this->mask      = table_size - 1; \
+        this->resize_at = umap_template_capacity(table_size); \
+        \
+        for (i = 0; i < old_table_size; i++) \
+        { \
+            if (old_meta[i].dist == 0) \
+                continue; \
+            \
+            hash = hash_fn(old_entries[i].key); \
+            idx = name##_core_probe(this, old_entries[i].key, hash, 1, &dist, &found); \
+            *name##_core_place(this, idx, hash, dist) = old_entries[i]; \
+        } \
+        \
+        free(old_entries); \
+        free(old_meta); \
+        \
+        return 1; \
+    } \
+    \
+    scope void name##_init(name##_t * this) \
+    { \
+        this->entries   = NULL; \
+        this->meta      = NULL; \
+        this->size      = 0; \
+        this->mask      = 0; \
+        this->resize_at = 0; \
+    } \
+    \
+    scope void name##_free(name##_t * this) \
+    { \
+        free(this->entries); \
+        free(this->meta); \
+        name##_init(this); \
+    } \
+    \
+    /* \
+     * adds the key with the value and returns the stored value. A key that \
+     * is already there keeps its value, like umap_add, assign through the \
+     * returned pointer to replace it. NULL when the table has to grow and \
+     * there is no memory, the table is unchanged then. \
+     */ \
+    scope val_t * name##_put(name##_t * this, key_t key, val_t value) \
+    { \
+        unsigned long hash = hash_fn(key), \
+                      idx; \
+        int dist, found; \
+        name##_entry_t * entry; \
+        \
+        if (this->size >= this->resize_at && \
+            !name##_core_resize(this, this->entries ? 2 * (this->mask + 1) : UMAP_TEMPLATE_MIN_SIZE)) \
+            return NULL; \
+        \
+        idx = name##_core_probe(this, key, hash, 0, &dist, &found); \
+        \
+        if (found) \
+            return &this->entries[idx].value; \
+        \
+        entry = name##_core_place(this, idx, hash, dist); \
+        entry->key      = key; \
+        entry->value    = value; \
+        this->size++; \
+        \
+        return &entry->value; \
+    } \
+    \
+    /* \
+     * returns the value of the key, or NULL if it isn't there. The pointer \
+     * stays valid until the next put or del. \
+     */ \
+    scope val_t * name##_get(name##_t * this, key_t key) \
+    { \
+        unsigned long idx; \
+        int dist, found; \
+        \
+        if (!this->entries) \
+            return NULL; \
+        \
+        idx = name##_core_probe(this, key, hash_fn(key), 0, &dist, &found); \
+        \
+        return found ? &this->entries[idx].value : NULL; \
+    } \
+    \
+    /* \
+     * removes the key and copies its value into ret if it isn't NULL. \
+     * Returns 1 if the key was there. \
+     */ \
+    scope int name##_del(name##_t * this, key_t key, val_t * ret) \
+    { \
+        unsigned long idx; \
+        int dist, found; \
+        \
+        if (!this->entries) \
+            return 0; \
+        \
+        idx = name##_core_probe(this, key, hash_fn(key), 0, &dist, &found); \
+        \
+        if (!found) \
+            return 0; \
+        \
+        if (ret) \
+            *ret = this->entries[idx].value; \
+        \
+        name##_core_remove(this, idx); \
+        this->size--; \
+        \
+        return 1; \
+    } \
+    \
+    /* \
+     * grows the table so count entries fit without another resize, returns \
+     * 0 when out of memory \
+     */ \
+    scope int name##_reserve(name##_t * this, unsigned long count) \
+    { \
+        unsigned long table_size = this->entries ? this->mask + 1 : UMAP_TEMPLATE_MIN_SIZE; \
+        \
+        while (count >= umap_template_capacity(table_size)) \
+            table_size *= 2; \
+        \
+        if (!this->entries || table_size > this->mask + 1) \
+            return name##_core_resize(this, table_size); \
+        \
+        return 1; \
+    } \
+    \
+    scope unsigned long name##_size(name##_t * this) \
+    { \
+        return this->size; \
+    } \
+    \
+    /* \
+     * bytes allocated by the table, the entries plus the metadata \
+     */ \
+    scope unsigned long name##_memory_usage(name##_t * this) \
+    { \
+        if (!this->entries) \
+            return 0; \
+        \
+        return (this->mask + 1) * (sizeof(name##_entry_t) + sizeof(hashtable_probe_meta_t)); \
+    } \
+    \
+    /* \
+     * returns the entry after pos and moves pos past it, or NULL once all \
+     * entries were returned. pos starts at 0, the slots are scanned in \
+     * memory order and the table mustn't change during a walk. \
+     */ \
+    scope name##_entry_t * name##_next(name##_t * this, unsigned long * pos) \
+    { \
+        if (!this->entries) \
+            return NULL; \
+        \
+        for (; *pos <= this->mask; (*pos)++) \
+        { \
+            if (this->meta[*pos].dist) \
+                return &this->entries[(*pos)++]; \
+        } \
+        \
+        return NULL; \
+    }
+
+/*
+ * the table type and all its functions, static inline
+ */
+#define UMAP_DECLARE(name, key_t, val_t, hash_fn, eq_fn) \
+    UMAP_TYPE(name, key_t, val_t) \
+    UMAP_FUNCS(static inline, name, key_t, val_t, hash_fn, eq_fn)
+
+/*
+ * the table type and prototypes for a header, the functions are generated
+ * by UMAP_DEFINE in one .c file
+ */
+#define UMAP_DECLARE_EXTERN(name, key_t, val_t) \
+    UMAP_TYPE(name, key_t, val_t) \
+    UMAP_PROTOTYPES(extern, name, key_t, val_t)
+
+#define UMAP_DEFINE(name, key_t, val_t, hash_fn, eq_fn) \
+    UMAP_FUNCS(, name, key_t, val_t, hash_fn, eq_fn)
+
+#endif
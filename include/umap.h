@@ -2,6 +2,7 @@
 #define _LIB_UMAP_H
 
 #include "lib/hashtable.h"
+#include "lib/key-arena.h"
 #include <stdarg.h>
 
 /*
@@ -11,9 +12,13 @@
 #define umap_key_t_int(m)   m->key_type = UMAP_KEY_TYPE_INT
 #define umap_key_t_dbl(m)   m->key_type = UMAP_KEY_TYPE_DOUBLE
 #define umap_key_t_str(m)   m->key_type = UMAP_KEY_TYPE_STRING
+#define umap_own_keys(m)    m->own_keys = 1 /* copy string keys into the map, see umap_t */
 #define umap_val_t_int(m)   m->val_type = UMAP_VAL_TYPE_INT
 #define umap_val_t_dbl(m)   m->val_type = UMAP_VAL_TYPE_DOUBLE
 #define umap_val_t_data(m)  m->val_type = UMAP_VAL_TYPE_DATA
+#define umap_hash_t_djb2(m)     m->ht.hash_type = HASH_TYPE_DJB2
+#define umap_hash_t_murmur(m)   m->ht.hash_type = HASH_TYPE_MURMUR
+#define umap_hash_t_sip(m)      m->ht.hash_type = HASH_TYPE_SIPHASH /* for keys from untrusted input */
 
 union _umap_datum {
     void * p;
@@ -33,22 +38,33 @@ typedef enum {
     UMAP_VAL_TYPE_DATA
 } umap_val_type_t;
 
-/* this needs to share the same structure as defined in hashtable.h */
+/* this needs to start with the same fields as the entries in hashtable.h */
 typedef struct _umap_entry {
-    int is_occupied;
-    unsigned long hash;
-    struct _umap_entry * left,
-                       * right,
-                       * next;
+    HASHTABLE_ENTRY_HEADER(_umap_entry)
+    int key_len; /* length of string keys, compared before the key bytes */
     union _umap_datum key,
                       value;
 } umap_entry_t;
 
+/*
+ * By default string keys are the caller's pointers, which have to stay
+ * valid for as long as they are in the map. After umap_own_keys the map
+ * copies every new string key into its key arena instead (see
+ * lib/key-arena.h), so the caller can reuse its buffer and the keys sit
+ * next to each other rather than all over the heap. The arena goes away
+ * in one piece with umap_free, and once enough keys are deleted the live
+ * ones are copied into a new arena in table order. That moves them, so a
+ * key pointer taken from the map is only good until the next umap_del or
+ * umap_shrink_to_fit. Has to be set before the first key is added.
+ */
 typedef struct {
     hashtable_t ht;
     
     umap_key_type_t key_type;
     umap_val_type_t val_type;
+    
+    key_arena_t keys; /* the string keys with own_keys */
+    int own_keys;
 } umap_t;
 
 umap_t * umap_create();
@@ -74,13 +90,98 @@ void umap_add(umap_t *, ...);
 int umap_get(umap_t *, ...);
 
 /*
- * the following get_* functions take the umap
- * as first parameter and the key as second parameter
+ * removes a key from the map. Same parameters as umap_get, the removed
+ * value is stored through the pointer if it isn't NULL.
+ *
+ * returns true if the key was there
+ */
+int umap_del(umap_t *, ...);
+
+/* position of a walk over the map, see umap_next */
+typedef hashtable_cursor_t umap_cursor_t;
+
+#define umap_cursor_init(c) hashtable_cursor_init(c)
+
+/*
+ * returns the entry after the cursor and moves the cursor past it, or NULL
+ * once all entries were returned. The entries come in the order they sit in
+ * the table, so a full walk is one sweep through memory. The map mustn't
+ * change during a walk.
+ *
+ *     umap_cursor_t c;
+ *     umap_entry_t * e;
+ *
+ *     umap_foreach(map, &c, e)
+ *         printf("%d\n", e->value.i);
+ */
+umap_entry_t * umap_next(umap_t *, umap_cursor_t *);
+
+#define umap_foreach(m, c, e) \
+    for (umap_cursor_init(c); ((e) = umap_next(m, c)) != NULL; )
+
+/*
+ * looks up num keys at once. keys points to an array of the current key
+ * type (int, double or char *). The value of each found key is stored in
+ * values and found[i] is set to whether keys[i] was found, either of them
+ * can be NULL. On big maps this is faster than umap_get in a loop since the
+ * lookups are prefetched ahead.
+ *
+ * returns the number of keys found
+ */
+int umap_get_many(umap_t *, const void * /* keys */, int /* num */, union _umap_datum * /* values */, int * /* found */);
+
+/*
+ * typed versions of umap_add and umap_get, named after the key and then
+ * the value type: i int, d double, s string, p data pointer. They take the
+ * key and value as they are instead of through the argument list and hash
+ * the key without switching on its type. The map's key and value types
+ * have to be set to match.
+ *
+ *     umap_put_si(map, "answer", 42);
+ *     if (umap_get_si(map, "answer", &i)) ...
+ */
+void umap_put_ii(umap_t *, int, int);
+void umap_put_id(umap_t *, int, double);
+void umap_put_ip(umap_t *, int, void *);
+void umap_put_di(umap_t *, double, int);
+void umap_put_dd(umap_t *, double, double);
+void umap_put_dp(umap_t *, double, void *);
+void umap_put_si(umap_t *, char *, int);
+void umap_put_sd(umap_t *, char *, double);
+void umap_put_sp(umap_t *, char *, void *);
+
+int umap_get_ii(umap_t *, int, int *);
+int umap_get_id(umap_t *, int, double *);
+int umap_get_ip(umap_t *, int, void **);
+int umap_get_di(umap_t *, double, int *);
+int umap_get_dd(umap_t *, double, double *);
+int umap_get_dp(umap_t *, double, void **);
+int umap_get_si(umap_t *, char *, int *);
+int umap_get_sd(umap_t *, char *, double *);
+int umap_get_sp(umap_t *, char *, void **);
+
+/*
+ * makes room for count entries up front, so adding them never resizes
+ */
+void umap_reserve(umap_t *, unsigned long /* count */);
+
+/*
+ * shrinks the umap to fit its entries, an empty umap frees its table. Owned
+ * keys are compacted if any were deleted.
+ */
+void umap_shrink_to_fit(umap_t *);
+
+/*
+ * bytes allocated by the umap, not counting the umap_t itself, the data
+ * pointed to by values or string keys the umap doesn't own
+ */
+unsigned long umap_memory_usage(umap_t *);
+
+/*
+ * load, longest probe and bytes of the umap's table, plus the probe
+ * histogram and resize counters when built with HASHTABLE_STATS
  */
-/* void *  umap_get_ref(umap_t *, ...);     returns a pointer to the data stored */
-/* int     umap_get_i(umap_t *, ...);       returns the data as an int */
-/* double  umap_get_d(umap_t *, ...);       returns the data as double */
-/* void *  umap_get_p(umap_t *, ...);       returns the data as pointer */
+void umap_stats(umap_t *, hashtable_stats_t *);
 
 void umap_free(umap_t *);
 void umap_destroy(umap_t *);
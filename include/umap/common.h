@@ -0,0 +1,33 @@
+#ifndef _LIB_UMAP_COMMON_H
+#define _LIB_UMAP_COMMON_H
+
+#include "lib/umap.h"
+
+/*
+ * key and value handling shared by the umap implementations. None of it
+ * depends on how the entries are stored.
+ */
+
+typedef union _umap_datum umap_datum_t;
+
+umap_datum_t    umap_get_va_key(umap_key_type_t, va_list);
+umap_datum_t    umap_get_va_val(umap_val_type_t, va_list);
+umap_datum_t    umap_get_array_key(umap_key_type_t, const void * keys, int i);
+
+/*
+ * sets the hash and key_len of the entry from its key
+ */
+void            umap_hash_entry_key(umap_key_type_t, hash_type_t, const hash_seed_t *, umap_entry_t *);
+
+/*
+ * stores the value where ret points as the value type, an int, a double
+ * or a pointer, so getting an int value into an int writes only the int
+ */
+void            umap_copy_val(umap_val_type_t, void * ret, umap_datum_t);
+
+/*
+ * compares the keys of two entries, returns 0 if equal like strcmp
+ */
+int             umap_key_cmp(umap_key_type_t, umap_entry_t *, umap_entry_t *);
+
+#endif
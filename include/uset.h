@@ -2,6 +2,7 @@
 #define _LIB_USET_H
 
 #include "lib/hashtable.h"
+#include "lib/key-arena.h"
 #include <stdarg.h>
 
 /*
@@ -11,9 +12,13 @@
 #define uset_key_t_int(m)   m->key_type = USET_KEY_TYPE_INT
 #define uset_key_t_dbl(m)   m->key_type = USET_KEY_TYPE_DOUBLE
 #define uset_key_t_str(m)   m->key_type = USET_KEY_TYPE_STRING
+#define uset_own_keys(m)    m->own_keys = 1 /* copy string keys into the set, see uset_t */
 #define uset_val_t_int(m)   m->val_type = USET_VAL_TYPE_INT
 #define uset_val_t_dbl(m)   m->val_type = USET_VAL_TYPE_DOUBLE
 #define uset_val_t_data(m)  m->val_type = USET_VAL_TYPE_DATA
+#define uset_hash_t_djb2(m)     m->ht.hash_type = HASH_TYPE_DJB2
+#define uset_hash_t_murmur(m)   m->ht.hash_type = HASH_TYPE_MURMUR
+#define uset_hash_t_sip(m)      m->ht.hash_type = HASH_TYPE_SIPHASH /* for keys from untrusted input */
 
 union _uset_datum {
     void * p;
@@ -33,39 +38,48 @@ typedef enum {
     USET_VAL_TYPE_DATA
 } uset_val_type_t;
 
-/* this needs to share the same structure as defined in hashtable.h */
+/* this needs to start with the same fields as the entries in hashtable.h */
 typedef struct _uset_entry {
-    int is_occupied;
-    unsigned long hash;
-    struct _uset_entry * left,
-                       * right,
-                       * next;
+    HASHTABLE_ENTRY_HEADER(_uset_entry)
+    int key_len; /* length of string keys, compared before the key bytes */
     union _uset_datum key;
 } uset_entry_t;
 
+/*
+ * By default string keys are the caller's pointers, which have to stay
+ * valid for as long as they are in the set. After uset_own_keys the set
+ * copies every new string key into its key arena instead (see
+ * lib/key-arena.h), so the caller can reuse its buffer and the keys sit
+ * next to each other rather than all over the heap. The arena goes away
+ * in one piece with uset_free, and once enough keys are deleted the live
+ * ones are copied into a new arena in table order. That moves them, so a
+ * key pointer taken from the set is only good until the next uset_del or
+ * uset_shrink_to_fit. Has to be set before the first key is added.
+ */
 typedef struct {
     hashtable_t ht;
     
     uset_key_type_t key_type;
     uset_val_type_t val_type;
+    
+    key_arena_t keys; /* the string keys with own_keys */
+    int own_keys;
 } uset_t;
 
 uset_t * uset_create();
 void uset_init(uset_t *);
 
 /*
- * add values to the unordered map. The parameters are
- * uset_t, key, value. The key and value will be parsed as whatever is the current
- * types are defined in the uset
+ * add keys to the unordered set. The parameters are
+ * uset_t, key. The key will be parsed as whatever the current
+ * key type is defined in the uset
  */
 void uset_add(uset_t *, ...);
 
 /*
- * accepts the uset, key, then a pointer for the data to be stored.
- * i.e. if you're retrieving on integer that has a string key,
- * the call to the function would like so:
+ * accepts the uset and the key to look for
  *
- * int i; uset_get(map, key, &i);
+ * uset_get(set, key);
  *
  * returns true if found or false if not found
  */
@@ -73,13 +87,72 @@ void uset_add(uset_t *, ...);
 int uset_get(uset_t *, ...);
 
 /*
- * the following get_* functions take the uset
- * as first parameter and the key as second parameter
+ * removes a key from the set, same parameters as uset_get
+ *
+ * returns true if the key was there
+ */
+int uset_del(uset_t *, ...);
+
+/* position of a walk over the set, see uset_next */
+typedef hashtable_cursor_t uset_cursor_t;
+
+#define uset_cursor_init(c) hashtable_cursor_init(c)
+
+/*
+ * returns the entry after the cursor and moves the cursor past it, or NULL
+ * once all entries were returned. The entries come in the order they sit in
+ * the table and the set mustn't change during a walk.
+ */
+uset_entry_t * uset_next(uset_t *, uset_cursor_t *);
+
+#define uset_foreach(s, c, e) \
+    for (uset_cursor_init(c); ((e) = uset_next(s, c)) != NULL; )
+
+/*
+ * checks num keys at once. keys points to an array of the current key type
+ * (int, double or char *) and found[i] is set to whether keys[i] is in the
+ * set, found can be NULL. On big sets this is faster than uset_get in a
+ * loop since the lookups are prefetched ahead.
+ *
+ * returns the number of keys found
+ */
+int uset_has_many(uset_t *, const void * /* keys */, int /* num */, int * /* found */);
+
+/*
+ * typed versions of uset_add and uset_get for int, double and string keys,
+ * they skip the argument list and the switches on the key type. The set's
+ * key type has to be set to match.
+ */
+void uset_put_i(uset_t *, int);
+void uset_put_d(uset_t *, double);
+void uset_put_s(uset_t *, char *);
+
+int uset_get_i(uset_t *, int);
+int uset_get_d(uset_t *, double);
+int uset_get_s(uset_t *, char *);
+
+/*
+ * makes room for count entries up front, so adding them never resizes
+ */
+void uset_reserve(uset_t *, unsigned long /* count */);
+
+/*
+ * shrinks the uset to fit its entries, an empty uset frees its table. Owned
+ * keys are compacted if any were deleted.
+ */
+void uset_shrink_to_fit(uset_t *);
+
+/*
+ * bytes allocated by the uset, not counting the uset_t itself or the
+ * strings pointed to by keys the uset doesn't own
+ */
+unsigned long uset_memory_usage(uset_t *);
+
+/*
+ * load, longest probe and bytes of the uset's table, plus the probe
+ * histogram and resize counters when built with HASHTABLE_STATS
  */
-/* void *  uset_get_ref(uset_t *, ...);     returns a pointer to the data stored */
-/* int     uset_get_i(uset_t *, ...);       returns the data as an int */
-/* double  uset_get_d(uset_t *, ...);       returns the data as double */
-/* void *  uset_get_p(uset_t *, ...);       returns the data as pointer */
+void uset_stats(uset_t *, hashtable_stats_t *);
 
 void uset_free(uset_t *);
 void uset_destroy(uset_t *);
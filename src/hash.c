@@ -1,8 +1,41 @@
 #include "lib/hash.h"
 
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
 #define HASH_INIT_VALUE 5381
 #define hash_byte(hash, c) ((hash << 5) + hash) + c
 
+#define MURMUR_SEED 0xe17a1465ULL
+#define MURMUR_M    0xc6a4a7935bd1e995ULL
+#define MURMUR_R    47
+
+#define SIP_K0      0x736f6d6570736575ULL
+#define SIP_K1      0x646f72616e646f6dULL
+#define sip_rotl(x, b) (uint64_t) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define HASH_PAGE_SIZE 4096
+#define hash_word_in_page(p) (((uintptr_t) (p) & (HASH_PAGE_SIZE - 1)) <= HASH_PAGE_SIZE - 8)
+#define hash_has_zero_byte(v) (((v) - 0x0101010101010101ULL) & ~(v) & 0x8080808080808080ULL)
+
+/* the word at a time string hash deliberately reads past the terminator */
+#if defined(__GNUC__) || defined(__clang__)
+#define HASH_NO_SANITIZE __attribute__((no_sanitize_address))
+#else
+#define HASH_NO_SANITIZE
+#endif
+
+static const hash_seed_t default_seed = {MURMUR_SEED, MURMUR_SEED};
+
+static uint64_t mix_64(uint64_t x);
+static uint64_t double_bits(double d);
+static uint64_t murmur_64a(const void * vdata, int len, uint64_t seed);
+static uint64_t murmur_64a_str(const char * str, int * len, uint64_t seed);
+static uint64_t sip_13(const void * vdata, int len, const hash_seed_t * seed);
+static uint64_t sip_13_str(const char * str, int * len, const hash_seed_t * seed);
+
 unsigned long hash_str(char * str)
 {
     unsigned long hash = HASH_INIT_VALUE;
@@ -26,3 +59,361 @@ unsigned long hash_bytes(void * vdata, int len)
         
     return hash;
 }
+
+void hash_seed_random(hash_seed_t * seed)
+{
+    static uint64_t process_key = 0,
+                    counter = 0;
+    FILE * fp;
+    uint64_t x;
+
+    /* one read of the system entropy per process, every seed is derived from it */
+    if (process_key == 0)
+    {
+        fp = fopen("/dev/urandom", "rb");
+
+        if (!fp || fread(&process_key, sizeof(process_key), 1, fp) != 1)
+            process_key = (uint64_t) time(NULL) ^ (uint64_t) (uintptr_t) &process_key;
+
+        if (fp)
+            fclose(fp);
+
+        process_key |= 1;
+    }
+
+    /* splitmix64 over a counter gives independent looking seeds per table */
+    x = process_key + (++counter) * 0x9e3779b97f4a7c15ULL;
+    seed->k0 = mix_64(x);
+    seed->k1 = mix_64(seed->k0 + 0x9e3779b97f4a7c15ULL);
+}
+
+unsigned long hash_int(unsigned long long x)
+{
+    return (unsigned long) mix_64(x ^ MURMUR_SEED);
+}
+
+unsigned long hash_double(double d)
+{
+    return (unsigned long) mix_64(double_bits(d) ^ MURMUR_SEED);
+}
+
+unsigned long hash_int_type(hash_type_t type, const hash_seed_t * seed, unsigned long long x)
+{
+    uint64_t k = x;
+
+    if (!seed)
+        seed = &default_seed;
+
+    if (type == HASH_TYPE_SIPHASH)
+        return (unsigned long) sip_13(&k, sizeof(k), seed);
+
+    return (unsigned long) mix_64(k ^ seed->k0);
+}
+
+unsigned long hash_double_type(hash_type_t type, const hash_seed_t * seed, double d)
+{
+    return hash_int_type(type, seed, double_bits(d));
+}
+
+unsigned long hash_str_len(hash_type_t type, const hash_seed_t * seed, char * str, int * len)
+{
+    unsigned long hash = HASH_INIT_VALUE;
+    char * p = str,
+         c;
+
+    if (!seed)
+        seed = &default_seed;
+
+    switch (type)
+    {
+        case HASH_TYPE_MURMUR:
+            return (unsigned long) murmur_64a_str(str, len, seed->k0);
+        case HASH_TYPE_SIPHASH:
+            return (unsigned long) sip_13_str(str, len, seed);
+        case HASH_TYPE_DJB2:
+        default:
+            while ((c = *p++))
+                hash = hash_byte(hash, c);
+
+            *len = p - str - 1;
+            return hash;
+    }
+}
+
+unsigned long hash_murmur_str(char * str)
+{
+    int len;
+    
+    return (unsigned long) murmur_64a_str(str, &len, MURMUR_SEED);
+}
+
+unsigned long hash_murmur_bytes(void * vdata, int len)
+{
+    return (unsigned long) murmur_64a(vdata, len, MURMUR_SEED);
+}
+
+unsigned long hash_sip_str(char * str, const hash_seed_t * seed)
+{
+    int len;
+    
+    return (unsigned long) sip_13_str(str, &len, seed ? seed : &default_seed);
+}
+
+unsigned long hash_sip_bytes(void * vdata, int len, const hash_seed_t * seed)
+{
+    return (unsigned long) sip_13(vdata, len, seed ? seed : &default_seed);
+}
+
+unsigned long hash_str_type(hash_type_t type, const hash_seed_t * seed, char * str)
+{
+    int len;
+    
+    return hash_str_len(type, seed, str, &len);
+}
+
+unsigned long hash_bytes_type(hash_type_t type, const hash_seed_t * seed, void * vdata, int len)
+{
+    if (!seed)
+        seed = &default_seed;
+
+    switch (type)
+    {
+        case HASH_TYPE_MURMUR:
+            return (unsigned long) murmur_64a(vdata, len, seed->k0);
+        case HASH_TYPE_SIPHASH:
+            return (unsigned long) sip_13(vdata, len, seed);
+        case HASH_TYPE_DJB2:
+        default:
+            return hash_bytes(vdata, len);
+    }
+}
+
+/*
+ * the splitmix64 finalizer, every input bit affects every output bit
+ */
+static uint64_t mix_64(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/*
+ * the bits of a double key, with -0.0 folded into 0.0 and every NaN into
+ * the one quiet NaN so equal keys always hash the same
+ */
+static uint64_t double_bits(double d)
+{
+    uint64_t bits;
+
+    if (d == 0.0)
+        return 0;
+
+    if (d != d)
+        return 0x7ff8000000000000ULL;
+
+    memcpy(&bits, &d, sizeof(bits));
+
+    return bits;
+}
+
+/*
+ * Loads the next 8 byte word of a null-terminated string into k. Returns 8
+ * if the word is full, otherwise the number of bytes before the terminator.
+ * The word is checked for the terminator with the has-zero-byte trick so
+ * only the final word is scanned byte by byte. A word is only loaded when
+ * it can't cross a page boundary, which means it may read past the
+ * terminator but never into an unmapped page.
+ */
+HASH_NO_SANITIZE static int hash_str_word(const unsigned char * data, uint64_t * k)
+{
+    int n;
+
+    if (hash_word_in_page(data))
+    {
+        memcpy(k, data, sizeof(*k));
+
+        if (!hash_has_zero_byte(*k))
+            return 8;
+    }
+
+    /* the terminator is somewhere in the next 8 bytes, or we are near a page boundary */
+    for (n = 0; n < 8 && data[n]; n++);
+
+    if (n == 8)
+        memcpy(k, data, sizeof(*k));
+
+    return n;
+}
+
+/*
+ * Based on MurmurHash64A by Austin Appleby (public domain). The length is
+ * folded in by the finalizer instead of the seed so a string can be hashed
+ * before its length is known. The 8 byte blocks are loaded with memcpy so
+ * unaligned keys are safe, the compiler turns it into a single load.
+ */
+static uint64_t murmur_block(uint64_t h, uint64_t k)
+{
+    k *= MURMUR_M;
+    k ^= k >> MURMUR_R;
+    k *= MURMUR_M;
+
+    h ^= k;
+    h *= MURMUR_M;
+
+    return h;
+}
+
+static uint64_t murmur_tail(uint64_t h, const unsigned char * data, int n)
+{
+    switch (n)
+    {
+        case 7: h ^= (uint64_t) data[6] << 48; /* fall through */
+        case 6: h ^= (uint64_t) data[5] << 40; /* fall through */
+        case 5: h ^= (uint64_t) data[4] << 32; /* fall through */
+        case 4: h ^= (uint64_t) data[3] << 24; /* fall through */
+        case 3: h ^= (uint64_t) data[2] << 16; /* fall through */
+        case 2: h ^= (uint64_t) data[1] << 8; /* fall through */
+        case 1: h ^= (uint64_t) data[0];
+                h *= MURMUR_M;
+    }
+
+    return h;
+}
+
+/* finalizer, makes sure every input bit avalanches */
+static uint64_t murmur_final(uint64_t h, int len)
+{
+    h ^= (uint64_t) len * MURMUR_M;
+    h *= MURMUR_M;
+
+    h ^= h >> MURMUR_R;
+    h *= MURMUR_M;
+    h ^= h >> MURMUR_R;
+
+    return h;
+}
+
+static uint64_t murmur_64a(const void * vdata, int len, uint64_t seed)
+{
+    const unsigned char * data = (const unsigned char *) vdata,
+                        * end = data + (len & ~7);
+    uint64_t h = seed,
+             k;
+
+    for (; data != end; data += 8)
+    {
+        memcpy(&k, data, sizeof(k));
+        h = murmur_block(h, k);
+    }
+
+    h = murmur_tail(h, data, len & 7);
+
+    return murmur_final(h, len);
+}
+
+static uint64_t murmur_64a_str(const char * str, int * len, uint64_t seed)
+{
+    const unsigned char * data = (const unsigned char *) str;
+    uint64_t h = seed,
+             k;
+    int n;
+
+    while ((n = hash_str_word(data, &k)) == 8)
+    {
+        h = murmur_block(h, k);
+        data += 8;
+    }
+
+    h = murmur_tail(h, data, n);
+    *len = (const char *) data - str + n;
+
+    return murmur_final(h, *len);
+}
+
+/*
+ * SipHash-1-3 by Aumasson and Bernstein, the reduced round variant that
+ * Rust and Python use for their hash tables. The message words are read
+ * little endian, the byte-wise tail below handles that for any host but the
+ * full 8 byte words assume a little endian host.
+ */
+typedef struct {
+    uint64_t v0, v1, v2, v3;
+} sip_state_t;
+
+#define sip_round(s) do { \
+    (s).v0 += (s).v1; (s).v1 = sip_rotl((s).v1, 13); (s).v1 ^= (s).v0; (s).v0 = sip_rotl((s).v0, 32); \
+    (s).v2 += (s).v3; (s).v3 = sip_rotl((s).v3, 16); (s).v3 ^= (s).v2; \
+    (s).v0 += (s).v3; (s).v3 = sip_rotl((s).v3, 21); (s).v3 ^= (s).v0; \
+    (s).v2 += (s).v1; (s).v1 = sip_rotl((s).v1, 17); (s).v1 ^= (s).v2; (s).v2 = sip_rotl((s).v2, 32); \
+} while (0)
+
+static void sip_init(sip_state_t * s, const hash_seed_t * seed)
+{
+    s->v0 = seed->k0 ^ SIP_K0;
+    s->v1 = seed->k1 ^ SIP_K1;
+    s->v2 = seed->k0 ^ 0x6c7967656e657261ULL;
+    s->v3 = seed->k1 ^ 0x7465646279746573ULL;
+}
+
+static void sip_block(sip_state_t * s, uint64_t m)
+{
+    s->v3 ^= m;
+    sip_round(*s);
+    s->v0 ^= m;
+}
+
+static uint64_t sip_final(sip_state_t * s, const unsigned char * tail, int n, int len)
+{
+    uint64_t b = (uint64_t) len << 56;
+
+    while (n--)
+        b |= (uint64_t) tail[n] << (8 * n);
+
+    sip_block(s, b);
+
+    s->v2 ^= 0xff;
+    sip_round(*s);
+    sip_round(*s);
+    sip_round(*s);
+
+    return s->v0 ^ s->v1 ^ s->v2 ^ s->v3;
+}
+
+static uint64_t sip_13(const void * vdata, int len, const hash_seed_t * seed)
+{
+    const unsigned char * data = (const unsigned char *) vdata,
+                        * end = data + (len & ~7);
+    sip_state_t s;
+    uint64_t m;
+
+    sip_init(&s, seed);
+
+    for (; data != end; data += 8)
+    {
+        memcpy(&m, data, sizeof(m));
+        sip_block(&s, m);
+    }
+
+    return sip_final(&s, data, len & 7, len);
+}
+
+static uint64_t sip_13_str(const char * str, int * len, const hash_seed_t * seed)
+{
+    const unsigned char * data = (const unsigned char *) str;
+    sip_state_t s;
+    uint64_t m;
+    int n;
+
+    sip_init(&s, seed);
+
+    while ((n = hash_str_word(data, &m)) == 8)
+    {
+        sip_block(&s, m);
+        data += 8;
+    }
+
+    *len = (const char *) data - str + n;
+
+    return sip_final(&s, data, n, *len);
+}
@@ -0,0 +1,616 @@
+#include "lib/hashtable.h"
+
+/* only compiled when this is the backend picked in lib/hashtable.h */
+#if HASHTABLE_BACKEND == HASHTABLE_BACKEND_CUCKOO
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define SLOTS HASHTABLE_CUCKOO_SLOTS
+#define HASHTABLE_MIN_BITS 2 /* 4 buckets, the two buckets of an entry always differ */
+
+/*
+ * the first bucket comes from the low bits of the hash, the second from a
+ * multiplicative mix of all of them, the tag from the top byte (never 0)
+ */
+#define hashtable_bucket1(ht, hash) ((hash) & (ht)->mask)
+#define hashtable_mix(hash)         ((unsigned long) (((unsigned long long) (hash) * 0x9e3779b97f4a7c15ULL) >> 32))
+#define hashtable_tag(hash)         ((unsigned char) (((hash) >> (sizeof(unsigned long) * 8 - 8)) | 1))
+
+#define hashtable_get_entry(ht, idx)    ((hashtable_entry_t *) ((char *) (ht)->table + (ht)->entry_size * (idx)))
+#define hashtable_stash_entry(ht, i)    ((hashtable_entry_t *) ((char *) (ht)->stash + (ht)->entry_size * (i)))
+/* slots past the end of the table are in the stash, idx is evaluated more than once */
+#define hashtable_get_slot(ht, idx)     ((idx) < (ht)->table_size ? hashtable_get_entry(ht, idx) : hashtable_stash_entry(ht, (idx) - (ht)->table_size))
+#if defined(__GNUC__) || defined(__clang__)
+#define hashtable_prefetch(addr) __builtin_prefetch(addr)
+#else
+#define hashtable_prefetch(addr)
+#endif
+#define hashtable_batch_entry(ht, entries, i) ((hashtable_entry_t *) ((char *) (entries) + (ht)->entry_size * (i)))
+#define hashtable_capacity(prime_idx) ((unsigned long) ((1UL << (prime_idx)) * SLOTS * HASHTABLE_LOAD_FACTOR))
+
+/* a bucket reached by the path search, and how it was reached */
+typedef struct {
+    unsigned long bucket;
+    int parent, /* index of the node whose entry moves here, -1 for the two home buckets */
+        slot, /* slot of that entry in the parent bucket */
+        depth;
+} hashtable_bfs_node_t;
+
+static void hashtable_set_size(hashtable_t *);
+static void hashtable_alloc(hashtable_t *);
+static void hashtable_resize_to(hashtable_t *, int prime_idx);
+static int hashtable_reinsert(hashtable_t *, void * old_table, unsigned char * old_tags, unsigned long old_table_size, void * old_stash, int old_stash_size);
+static unsigned long hashtable_bucket2(hashtable_t *, unsigned long hash);
+static unsigned long hashtable_other_bucket(hashtable_t *, unsigned long hash, unsigned long bucket);
+static int hashtable_find(hashtable_t *, hashtable_entry_t * entry, unsigned long * idx);
+static int hashtable_find_free(hashtable_t *, unsigned long bucket, unsigned long * idx);
+static int hashtable_cuckoo_path(hashtable_t *, unsigned long b1, unsigned long b2, unsigned long * idx);
+static hashtable_entry_t * hashtable_place(hashtable_t *, hashtable_entry_t * entry);
+static void hashtable_remove(hashtable_t *, unsigned long idx);
+static void hashtable_prefetch_home(hashtable_t *, hashtable_entry_t * entry);
+
+hashtable_t * hashtable_create(int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
+{
+    hashtable_t * this = malloc(sizeof(hashtable_t));
+
+    hashtable_init(this, entry_size, entry_cmp, entry_cmp_state, hash_type, hash_seed);
+
+    return this;
+}
+
+void hashtable_init(hashtable_t * this, int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
+{
+    this->size              = 0;
+    this->prime_idx         = HASHTABLE_MIN_BITS;
+    this->entry_size        = entry_size;
+    this->entry_cmp         = entry_cmp;
+    this->entry_cmp_state   = entry_cmp_state;
+    this->hash_type         = hash_type;
+
+    /* every table gets its own seed so colliding keys can't be precomputed */
+    if (hash_seed)
+        this->hash_seed = *hash_seed;
+    else
+        hash_seed_random(&this->hash_seed);
+
+    hashtable_stats_init(this);
+
+    /* the table is allocated by the first insert */
+    this->table         = NULL;
+    this->tags          = NULL;
+    this->stash         = NULL;
+    this->stash_size    = 0;
+    hashtable_set_size(this);
+}
+
+void * hashtable_lookup_entry(hashtable_t * this, void * entry, hashtable_lookup_t lu_type)
+{
+    unsigned long idx;
+    hashtable_entry_t * ht_entry;
+
+    if (!this->table)
+    {
+        /* nothing to find until the first insert allocates the table */
+        if (lu_type != HASHTABLE_LOOKUP_INSERT)
+            return NULL;
+
+        hashtable_alloc(this);
+    }
+
+    if (hashtable_find(this, entry, &idx))
+    {
+        ht_entry = hashtable_get_slot(this, idx);
+
+        if (lu_type != HASHTABLE_LOOKUP_DELETE)
+            return ht_entry;
+
+        memcpy(entry, ht_entry, this->entry_size);
+        hashtable_remove(this, idx);
+        this->size--;
+
+        return entry;
+    }
+
+    /* if we are looking for a node, and didn't find it, return NULL */
+    if (lu_type != HASHTABLE_LOOKUP_INSERT)
+        return NULL;
+
+    if (this->size >= this->resize_at)
+        hashtable_resize_to(this, this->prime_idx + 1);
+
+    /* no path and a full stash, the table is too crowded even below the load factor */
+    while (!(ht_entry = hashtable_place(this, entry)))
+        hashtable_resize_to(this, this->prime_idx + 1);
+
+    ht_entry->is_occupied = 1;
+    this->size++;
+
+    return ht_entry;
+}
+
+int hashtable_lookup_batch(hashtable_t * this, void * entries, int num, void ** results)
+{
+    int i,
+        found = 0;
+
+    if (!this->table)
+    {
+        memset(results, 0, num * sizeof(void *));
+        return 0;
+    }
+
+    for (i = 0; i < num && i < HASHTABLE_PREFETCH_DISTANCE; i++)
+        hashtable_prefetch_home(this, hashtable_batch_entry(this, entries, i));
+
+    for (i = 0; i < num; i++)
+    {
+        if (i + HASHTABLE_PREFETCH_DISTANCE < num)
+            hashtable_prefetch_home(this, hashtable_batch_entry(this, entries, i + HASHTABLE_PREFETCH_DISTANCE));
+
+        results[i] = hashtable_lookup_entry(this, hashtable_batch_entry(this, entries, i), HASHTABLE_LOOKUP_SEARCH);
+
+        if (results[i])
+            found++;
+    }
+
+    return found;
+}
+
+void hashtable_reserve(hashtable_t * this, unsigned long count)
+{
+    int prime_idx = this->prime_idx;
+
+    while (count > hashtable_capacity(prime_idx))
+        prime_idx++;
+
+    if (prime_idx != this->prime_idx)
+        hashtable_resize_to(this, prime_idx);
+}
+
+void hashtable_shrink_to_fit(hashtable_t * this)
+{
+    int prime_idx = HASHTABLE_MIN_BITS;
+
+    if (this->size == 0)
+    {
+        hashtable_free(this);
+        this->prime_idx     = HASHTABLE_MIN_BITS;
+        this->table         = NULL;
+        this->tags          = NULL;
+        this->stash         = NULL;
+        this->stash_size    = 0;
+        hashtable_set_size(this);
+        return;
+    }
+
+    while (this->size > hashtable_capacity(prime_idx))
+        prime_idx++;
+
+    if (prime_idx < this->prime_idx)
+        hashtable_resize_to(this, prime_idx);
+}
+
+void hashtable_free(hashtable_t * this)
+{
+    free(this->table);
+    free(this->tags);
+    free(this->stash);
+}
+
+void hashtable_destroy(hashtable_t * this)
+{
+    hashtable_free(this);
+    free(this);
+}
+
+unsigned long hashtable_memory_usage(hashtable_t * this)
+{
+    if (!this->table)
+        return 0;
+
+    return this->table_size * this->entry_size + this->table_size + HASHTABLE_CUCKOO_STASH * this->entry_size;
+}
+
+void hashtable_stats(hashtable_t * this, hashtable_stats_t * stats)
+{
+    unsigned long i;
+
+    hashtable_stats_counters(this, stats);
+
+    stats->size         = this->size;
+    stats->table_size   = this->table_size;
+    stats->load_factor  = (double) this->size / this->table_size;
+    stats->bytes        = hashtable_memory_usage(this);
+    stats->max_chain    = 0;
+
+    if (!this->table)
+        return;
+
+    /* an entry in its second bucket takes two bucket reads, one in the stash three */
+    if (this->stash_size)
+    {
+        stats->max_chain = 3;
+        return;
+    }
+
+    for (i = 0; i < this->table_size && stats->max_chain < 2; i++)
+    {
+        if (!this->tags[i])
+            continue;
+
+        if (stats->max_chain < 1)
+            stats->max_chain = 1;
+
+        if (i / SLOTS != hashtable_bucket1(this, hashtable_get_entry(this, i)->hash))
+            stats->max_chain = 2;
+    }
+}
+
+void * hashtable_next(hashtable_t * this, hashtable_cursor_t * cursor)
+{
+    if (!this->table)
+        return NULL;
+
+    for (; cursor->idx < this->table_size; cursor->idx++)
+    {
+        if (this->tags[cursor->idx])
+            return hashtable_get_entry(this, cursor->idx++);
+    }
+
+    /* past the table the cursor counts through the stash */
+    if (cursor->idx < this->table_size + this->stash_size)
+        return hashtable_stash_entry(this, cursor->idx++ - this->table_size);
+
+    return NULL;
+}
+
+void hashtable_print(hashtable_t * this)
+{
+    unsigned long i,
+                  occupied = 0;
+
+    if (!this->table)
+        return;
+
+    for (i = 0; i < this->table_size; i++)
+    {
+        if (this->tags[i])
+            occupied++;
+    }
+
+    printf("table size = %ld\n", this->table_size);
+    printf("occupied size = %ld, stash = %d\n", occupied, this->stash_size);
+}
+
+/*
+ * sets the table size for 1 << prime_idx buckets
+ */
+static void hashtable_set_size(hashtable_t * this)
+{
+    this->table_size    = (1UL << this->prime_idx) * SLOTS;
+    this->mask          = (1UL << this->prime_idx) - 1;
+    this->resize_at     = hashtable_capacity(this->prime_idx);
+}
+
+/*
+ * allocates the entries, tags and stash for the table size
+ */
+static void hashtable_alloc(hashtable_t * this)
+{
+    /* the tags decide which slots are used, so the entries don't need clearing */
+    this->table         = malloc(this->table_size * this->entry_size);
+    this->tags          = calloc(this->table_size, 1);
+    this->stash         = malloc(HASHTABLE_CUCKOO_STASH * this->entry_size);
+    this->stash_size    = 0;
+}
+
+/*
+ * re indexes the entries into a table of 1 << prime_idx buckets. Before the
+ * first insert only the size is changed. If the entries don't all fit the
+ * table is doubled again.
+ */
+static void hashtable_resize_to(hashtable_t * this, int prime_idx)
+{
+    unsigned long old_table_size = this->table_size;
+    void * old_table = this->table,
+         * old_stash = this->stash;
+    unsigned char * old_tags = this->tags;
+    int old_stash_size = this->stash_size;
+
+    this->prime_idx = prime_idx;
+    hashtable_set_size(this);
+
+    if (!old_table)
+        return;
+
+    hashtable_count_resize(this);
+    hashtable_resize_begin(this);
+
+    /* TODO - proper error handling */
+
+    hashtable_alloc(this);
+
+    while (!hashtable_reinsert(this, old_table, old_tags, old_table_size, old_stash, old_stash_size))
+    {
+        hashtable_free(this);
+
+        this->prime_idx++;
+        hashtable_set_size(this);
+        hashtable_alloc(this);
+    }
+
+    free(old_table);
+    free(old_tags);
+    free(old_stash);
+
+    hashtable_resize_end(this);
+}
+
+/*
+ * places the entries of the old arrays, returns 0 if one of them didn't fit
+ */
+static int hashtable_reinsert(hashtable_t * this, void * old_table, unsigned char * old_tags, unsigned long old_table_size, void * old_stash, int old_stash_size)
+{
+    unsigned long i;
+    int j;
+
+    for (i = 0; i < old_table_size; i++)
+    {
+        if (old_tags[i] && !hashtable_place(this, (hashtable_entry_t *) ((char *) old_table + i * this->entry_size)))
+            return 0;
+    }
+
+    for (j = 0; j < old_stash_size; j++)
+    {
+        if (!hashtable_place(this, (hashtable_entry_t *) ((char *) old_stash + j * this->entry_size)))
+            return 0;
+    }
+
+    return 1;
+}
+
+static unsigned long hashtable_bucket2(hashtable_t * this, unsigned long hash)
+{
+    unsigned long b1 = hashtable_bucket1(this, hash),
+                  b2 = hashtable_mix(hash) & this->mask;
+
+    return b2 != b1 ? b2 : b1 ^ 1;
+}
+
+/*
+ * the bucket an entry in bucket would move to
+ */
+static unsigned long hashtable_other_bucket(hashtable_t * this, unsigned long hash, unsigned long bucket)
+{
+    unsigned long b1 = hashtable_bucket1(this, hash);
+
+    return bucket == b1 ? hashtable_bucket2(this, hash) : b1;
+}
+
+/*
+ * Looks in the two buckets of the entry, then in the stash if anything is
+ * in it. Only entries whose tag matches are read. idx is set to the slot of
+ * the match, stash slots start at table_size.
+ */
+static int hashtable_find(hashtable_t * this, hashtable_entry_t * entry, unsigned long * idx)
+{
+    unsigned long bucket = hashtable_bucket1(this, entry->hash),
+                  i;
+    unsigned char tag = hashtable_tag(entry->hash);
+    int probe,
+        j;
+    hashtable_entry_t * ht_entry;
+
+    for (probe = 1; probe <= 2; probe++)
+    {
+        for (i = bucket * SLOTS; i < (bucket + 1) * SLOTS; i++)
+        {
+            if (this->tags[i] != tag)
+                continue;
+
+            ht_entry = hashtable_get_entry(this, i);
+
+            if (ht_entry->hash == entry->hash && this->entry_cmp(ht_entry, entry, this->entry_cmp_state) == 0)
+            {
+                hashtable_count_probe(this, probe);
+                *idx = i;
+                return 1;
+            }
+        }
+
+        bucket = hashtable_bucket2(this, entry->hash);
+    }
+
+    hashtable_count_probe(this, this->stash_size ? 3 : 2);
+
+    for (j = 0; j < this->stash_size; j++)
+    {
+        ht_entry = hashtable_stash_entry(this, j);
+
+        if (ht_entry->hash == entry->hash && this->entry_cmp(ht_entry, entry, this->entry_cmp_state) == 0)
+        {
+            *idx = this->table_size + j;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int hashtable_find_free(hashtable_t * this, unsigned long bucket, unsigned long * idx)
+{
+    unsigned long i;
+
+    for (i = bucket * SLOTS; i < (bucket + 1) * SLOTS; i++)
+    {
+        if (!this->tags[i])
+        {
+            *idx = i;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Breadth first search from the two full home buckets for the closest
+ * bucket with a free slot, following each entry to its other bucket. The
+ * entries along the path are then moved one step, starting from the far
+ * end, which frees a slot in a home bucket. A bucket is never on its own
+ * path twice, so every move takes an entry to its other bucket. Sets idx to
+ * the freed slot and returns 1, or returns 0 if no path was found within
+ * HASHTABLE_CUCKOO_MAX_PATH moves.
+ */
+static int hashtable_cuckoo_path(hashtable_t * this, unsigned long b1, unsigned long b2, unsigned long * idx)
+{
+    hashtable_bfs_node_t queue[HASHTABLE_CUCKOO_BFS_NODES];
+    unsigned long free_idx,
+                  src,
+                  alt;
+    int head = 0,
+        tail = 0,
+        node,
+        parent,
+        i;
+
+    queue[tail].bucket = b1;
+    queue[tail].parent = -1;
+    queue[tail].slot   = 0;
+    queue[tail++].depth = 0;
+
+    queue[tail].bucket = b2;
+    queue[tail].parent = -1;
+    queue[tail].slot   = 0;
+    queue[tail++].depth = 0;
+
+    while (head < tail)
+    {
+        node = head++;
+
+        if (hashtable_find_free(this, queue[node].bucket, &free_idx))
+        {
+            while (queue[node].parent >= 0)
+            {
+                src = queue[queue[node].parent].bucket * SLOTS + queue[node].slot;
+
+                memcpy(hashtable_get_entry(this, free_idx), hashtable_get_entry(this, src), this->entry_size);
+                this->tags[free_idx] = this->tags[src];
+                this->tags[src] = 0;
+
+                free_idx = src;
+                node = queue[node].parent;
+            }
+
+            *idx = free_idx;
+            return 1;
+        }
+
+        if (queue[node].depth == HASHTABLE_CUCKOO_MAX_PATH)
+            continue;
+
+        for (i = 0; i < SLOTS && tail < HASHTABLE_CUCKOO_BFS_NODES; i++)
+        {
+            alt = hashtable_other_bucket(this, hashtable_get_entry(this, queue[node].bucket * SLOTS + i)->hash, queue[node].bucket);
+
+            for (parent = node; parent >= 0 && queue[parent].bucket != alt; parent = queue[parent].parent)
+                ;
+
+            if (parent >= 0)
+                continue;
+
+            queue[tail].bucket  = alt;
+            queue[tail].parent  = node;
+            queue[tail].slot    = i;
+            queue[tail++].depth = queue[node].depth + 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Puts an entry that isn't in the table yet into one of its buckets, making
+ * room by moving others, or into the stash. Returns the copy or NULL if
+ * neither worked.
+ */
+static hashtable_entry_t * hashtable_place(hashtable_t * this, hashtable_entry_t * entry)
+{
+    unsigned long b1 = hashtable_bucket1(this, entry->hash),
+                  b2 = hashtable_bucket2(this, entry->hash),
+                  idx;
+    hashtable_entry_t * dst;
+
+    if (hashtable_find_free(this, b1, &idx) || hashtable_find_free(this, b2, &idx) || hashtable_cuckoo_path(this, b1, b2, &idx))
+    {
+        dst = hashtable_get_entry(this, idx);
+        this->tags[idx] = hashtable_tag(entry->hash);
+    }
+    else if (this->stash_size < HASHTABLE_CUCKOO_STASH)
+    {
+        dst = hashtable_stash_entry(this, this->stash_size++);
+    }
+    else
+    {
+        return NULL;
+    }
+
+    memcpy(dst, entry, this->entry_size);
+
+    return dst;
+}
+
+/*
+ * Empties the slot at idx. A stash entry that belongs to the freed bucket
+ * moves into it, the stash is searched by every miss so it's kept short.
+ */
+static void hashtable_remove(hashtable_t * this, unsigned long idx)
+{
+    unsigned long bucket;
+    hashtable_entry_t * stashed;
+    int i;
+
+    if (idx >= this->table_size)
+    {
+        i = idx - this->table_size;
+
+        if (i != --this->stash_size)
+            memcpy(hashtable_stash_entry(this, i), hashtable_stash_entry(this, this->stash_size), this->entry_size);
+
+        return;
+    }
+
+    this->tags[idx] = 0;
+    bucket = idx / SLOTS;
+
+    for (i = 0; i < this->stash_size; i++)
+    {
+        stashed = hashtable_stash_entry(this, i);
+
+        if (hashtable_bucket1(this, stashed->hash) == bucket || hashtable_bucket2(this, stashed->hash) == bucket)
+        {
+            memcpy(hashtable_get_entry(this, idx), stashed, this->entry_size);
+            this->tags[idx] = hashtable_tag(stashed->hash);
+            hashtable_remove(this, this->table_size + i);
+            return;
+        }
+    }
+}
+
+/*
+ * prefetches the tags and the first entry of both buckets
+ */
+static void hashtable_prefetch_home(hashtable_t * this, hashtable_entry_t * entry)
+{
+    unsigned long b1 = hashtable_bucket1(this, entry->hash),
+                  b2 = hashtable_bucket2(this, entry->hash);
+
+    hashtable_prefetch(this->tags + b1 * SLOTS);
+    hashtable_prefetch(hashtable_get_entry(this, b1 * SLOTS));
+    hashtable_prefetch(this->tags + b2 * SLOTS);
+    hashtable_prefetch(hashtable_get_entry(this, b2 * SLOTS));
+}
+
+#endif /* HASHTABLE_BACKEND == HASHTABLE_BACKEND_CUCKOO */
@@ -1,10 +1,20 @@
 #include "lib/hashtable.h"
+
+/* only compiled when this is the backend picked in lib/hashtable.h */
+#if HASHTABLE_BACKEND == HASHTABLE_BACKEND_LIST
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
 
 #define hashtable_get_entry(ht, idx) ht->table + ((ht->entry_size * (idx)) % (ht->table_size * ht->entry_size))
+#if defined(__GNUC__) || defined(__clang__)
+#define hashtable_prefetch(addr) __builtin_prefetch(addr)
+#else
+#define hashtable_prefetch(addr)
+#endif
+#define hashtable_batch_entry(ht, entries, i) ((hashtable_entry_t *) ((char *) (entries) + (ht)->entry_size * (i)))
 #define hashtable_should_resize(ht) if ((float) ht->size / ht->table_size >= HASHTABLE_LOAD_FACTOR) hashtable_resize(ht);
 
 static unsigned long prime_doubles[] = {
@@ -64,32 +74,45 @@ static unsigned long prime_doubles[] = {
 
 static void * hashtable_probe(hashtable_t *, hashtable_entry_t * entry,hashtable_lookup_t lu_type);
 static void hashtable_resize(hashtable_t *);
+static void hashtable_resize_to(hashtable_t *, int prime_idx);
+static int hashtable_remove(hashtable_t *, hashtable_entry_t * entry);
+static void hashtable_prefetch_home(hashtable_t *, hashtable_entry_t * entry);
 
-static int hashtable_entry_in_table(hashtable_t * this, hashtable_entry_t * entry, void * old_table)
+static int hashtable_entry_in_table(hashtable_t * this, hashtable_entry_t * entry, void * old_table, unsigned long old_table_size)
 {
-    return (old_table <= entry && entry < (old_table + this->table_size * this->entry_size));
+    return (old_table <= (void *) entry && (void *) entry < (old_table + old_table_size * this->entry_size));
 }
 
-hashtable_t * hashtable_create(int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state)
+hashtable_t * hashtable_create(int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
 {
     hashtable_t * this = malloc(sizeof(hashtable_t));
     
-    hashtable_init(this, entry_size, entry_cmp, entry_cmp_state);
+    hashtable_init(this, entry_size, entry_cmp, entry_cmp_state, hash_type, hash_seed);
     
     return this;
 }
 
-void hashtable_init(hashtable_t * this, int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state)
+void hashtable_init(hashtable_t * this, int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
 {
     this->size              = 0;
     this->prime_idx         = 0;
     this->entry_size        = entry_size;
     this->entry_cmp         = entry_cmp;
     this->entry_cmp_state   = entry_cmp_state;
+    this->hash_type         = hash_type;
+    
+    /* every table gets its own seed so colliding keys can't be precomputed */
+    if (hash_seed)
+        this->hash_seed = *hash_seed;
+    else
+        hash_seed_random(&this->hash_seed);
+    
     this->table_size        = prime_doubles[this->prime_idx];
     
-    /* eager initialize the hashtable data, probably should lazy load instead */
-    this->table = calloc(this->table_size, this->entry_size);
+    hashtable_stats_init(this);
+    
+    /* the table is allocated by the first insert */
+    this->table = NULL;
 }
 
 void * hashtable_lookup_entry(hashtable_t * this, void * entry, hashtable_lookup_t lu_type)
@@ -97,9 +120,21 @@ void * hashtable_lookup_entry(hashtable_t * this, void * entry, hashtable_lookup
     unsigned long idx;
     hashtable_entry_t * ht_entry;
 
+    if (!this->table)
+    {
+        /* nothing to find until the first insert allocates the table */
+        if (lu_type != HASHTABLE_LOOKUP_INSERT)
+            return NULL;
+        
+        this->table = calloc(this->table_size, this->entry_size);
+    }
+
     /* should we resize? */
     hashtable_should_resize(this); /* only resizes if it needs to */
     
+    if (lu_type == HASHTABLE_LOOKUP_DELETE)
+        return hashtable_remove(this, entry) ? entry : NULL;
+    
     ht_entry = hashtable_probe(this, entry, lu_type);
 
     /* not found... */
@@ -120,10 +155,6 @@ void * hashtable_lookup_entry(hashtable_t * this, void * entry, hashtable_lookup
             ht_entry->next = NULL;
             this->size++;
             break;
-        case HASHTABLE_LOOKUP_DELETE:
-            ht_entry->is_occupied = 0;
-            this->size--;
-            break;
         default:
             return NULL;
             break;
@@ -132,8 +163,87 @@ void * hashtable_lookup_entry(hashtable_t * this, void * entry, hashtable_lookup
     return ht_entry;
 }
 
+int hashtable_lookup_batch(hashtable_t * this, void * entries, int num, void ** results)
+{
+    int i,
+        found = 0;
+    
+    if (!this->table)
+    {
+        memset(results, 0, num * sizeof(void *));
+        return 0;
+    }
+    
+    for (i = 0; i < num && i < HASHTABLE_PREFETCH_DISTANCE; i++)
+        hashtable_prefetch_home(this, hashtable_batch_entry(this, entries, i));
+    
+    for (i = 0; i < num; i++)
+    {
+        if (i + HASHTABLE_PREFETCH_DISTANCE < num)
+            hashtable_prefetch_home(this, hashtable_batch_entry(this, entries, i + HASHTABLE_PREFETCH_DISTANCE));
+        
+        results[i] = hashtable_lookup_entry(this, hashtable_batch_entry(this, entries, i), HASHTABLE_LOOKUP_SEARCH);
+        
+        if (results[i])
+            found++;
+    }
+    
+    return found;
+}
+
+void hashtable_reserve(hashtable_t * this, unsigned long count)
+{
+    int prime_idx = this->prime_idx;
+    
+    while ((float) count / prime_doubles[prime_idx] >= HASHTABLE_LOAD_FACTOR)
+        prime_idx++;
+    
+    if (prime_idx != this->prime_idx)
+        hashtable_resize_to(this, prime_idx);
+}
+
+void hashtable_shrink_to_fit(hashtable_t * this)
+{
+    int prime_idx = 0;
+    
+    if (this->size == 0)
+    {
+        hashtable_free(this);
+        this->prime_idx     = 0;
+        this->table_size    = prime_doubles[this->prime_idx];
+        this->table         = NULL;
+        return;
+    }
+    
+    while ((float) this->size / prime_doubles[prime_idx] >= HASHTABLE_LOAD_FACTOR)
+        prime_idx++;
+    
+    if (prime_idx < this->prime_idx)
+        hashtable_resize_to(this, prime_idx);
+}
+
 void hashtable_free(hashtable_t * this)
 {
+    unsigned long i;
+    hashtable_entry_t * entry,
+                      * tmp;
+    
+    if (!this->table)
+        return;
+    
+    /* free the nodes chained off each slot */
+    for (i = 0; i < this->table_size; i++)
+    {
+        entry = ((hashtable_entry_t *) ((char *) this->table + i * this->entry_size))->next;
+        
+        while (entry)
+        {
+            tmp = entry;
+            entry = entry->next;
+            free(tmp);
+        }
+    }
+    
     free(this->table);
 }
 
@@ -143,6 +253,84 @@ void hashtable_destroy(hashtable_t * this)
     free(this);
 }
 
+unsigned long hashtable_memory_usage(hashtable_t * this)
+{
+    unsigned long bytes = this->table_size * this->entry_size,
+                  i;
+    hashtable_entry_t * entry;
+    
+    if (!this->table)
+        return 0;
+    
+    /* count the overflow nodes chained off each slot */
+    for (i = 0; i < this->table_size; i++)
+    {
+        entry = (hashtable_entry_t *) ((char *) this->table + i * this->entry_size);
+        
+        for (entry = entry->next; entry; entry = entry->next)
+            bytes += this->entry_size;
+    }
+    
+    return bytes;
+}
+
+void hashtable_stats(hashtable_t * this, hashtable_stats_t * stats)
+{
+    unsigned long i, length;
+    hashtable_entry_t * entry;
+    
+    hashtable_stats_counters(this, stats);
+    
+    stats->size         = this->size;
+    stats->table_size   = this->table_size;
+    stats->load_factor  = (double) this->size / this->table_size;
+    stats->bytes        = hashtable_memory_usage(this);
+    stats->max_chain    = 0;
+    
+    if (!this->table)
+        return;
+    
+    for (i = 0; i < this->table_size; i++)
+    {
+        entry = (hashtable_entry_t *) ((char *) this->table + i * this->entry_size);
+        
+        for (length = 0; entry && entry->is_occupied; entry = entry->next)
+            length++;
+        
+        if (length > stats->max_chain)
+            stats->max_chain = length;
+    }
+}
+
+void * hashtable_next(hashtable_t * this, hashtable_cursor_t * cursor)
+{
+    hashtable_entry_t * entry;
+    
+    if (cursor->node)
+    {
+        entry = cursor->node;
+        cursor->node = entry->next;
+        return entry;
+    }
+    
+    if (!this->table)
+        return NULL;
+    
+    for (; cursor->idx < this->table_size; cursor->idx++)
+    {
+        entry = (hashtable_entry_t *) ((char *) this->table + cursor->idx * this->entry_size);
+        
+        if (entry->is_occupied)
+        {
+            cursor->idx++;
+            cursor->node = entry->next;
+            return entry;
+        }
+    }
+    
+    return NULL;
+}
+
 void hashtable_print(hashtable_t * this)
 {
     unsigned long i, occupied = 0;
@@ -152,6 +340,9 @@ void hashtable_print(hashtable_t * this)
     "   hash = %ld\n"
     "}\n";
     
+    if (!this->table)
+        return;
+    
     for (i = 0; i < this->table_size * this->entry_size; i += this->entry_size)
     {
         entry = (hashtable_entry_t *) ((char *)this->table + i);
@@ -167,18 +358,34 @@ void hashtable_print(hashtable_t * this)
 
 static void hashtable_resize(hashtable_t * this)
 {
-    unsigned long old_size = this->table_size * this->entry_size,
+    hashtable_resize_to(this, this->prime_idx + 1);
+}
+
+/*
+ * re indexes the entries into a table of prime_doubles[prime_idx] entries.
+ * Before the first insert only the size is changed.
+ */
+static void hashtable_resize_to(hashtable_t * this, int prime_idx)
+{
+    unsigned long old_table_size = this->table_size,
+                  old_size = this->table_size * this->entry_size,
                   i;
     int use_entry;
     void * old_table = this->table;
     hashtable_entry_t * old_entry,
                       * new_entry,
                       * tmp;
-    this->prime_idx++;
+    this->prime_idx = prime_idx;
+    this->table_size = prime_doubles[this->prime_idx];
+    
+    if (!old_table)
+        return;
+    
+    hashtable_count_resize(this);
+    hashtable_resize_begin(this);
     
     /* TODO - proper error handling */
     
-    this->table_size = prime_doubles[this->prime_idx];
     this->table = calloc(this->table_size, this->entry_size);
 
     /* re index the entries */
@@ -201,7 +408,7 @@ static void hashtable_resize(hashtable_t * this)
             tmp = old_entry;
             old_entry = old_entry->next;
             
-            if (!hashtable_entry_in_table(this, tmp, old_table))
+            if (!hashtable_entry_in_table(this, tmp, old_table, old_table_size))
             {
                 free(tmp);
             }
@@ -209,6 +416,8 @@ static void hashtable_resize(hashtable_t * this)
     }
     
     free(old_table);
+    
+    hashtable_resize_end(this);
 }
 
 static void * hashtable_probe(hashtable_t * this, hashtable_entry_t * entry, hashtable_lookup_t lu_type)
@@ -228,15 +437,25 @@ static void * hashtable_probe(hashtable_t * this, hashtable_entry_t * entry, has
     while (p)
     {
         if (p->is_occupied == 0)
+        {
+            hashtable_count_probe(this, i);
             return p;
+        }
      
-        if (p->hash == entry->hash && this->entry_cmp(p, entry, this->entry_cmp_state))
+        i++;
+        
+        if (p->hash == entry->hash && this->entry_cmp(p, entry, this->entry_cmp_state) == 0)
+        {
+            hashtable_count_probe(this, i);
             return p;
+        }
      
         prev = p;
         
         p = p->next;    // iterate to next element
     }
+    
+    hashtable_count_probe(this, i);
 
     // if we've made it this far, then there is no match. return new element
     if (lu_type != HASHTABLE_LOOKUP_INSERT)
@@ -248,3 +467,54 @@ static void * hashtable_probe(hashtable_t * this, hashtable_entry_t * entry, has
     
     return new_entry;
 }
+
+/*
+ * takes the entry matching entry out of its bucket's chain and copies it
+ * into entry. Returns 0 if it isn't there.
+ */
+static int hashtable_remove(hashtable_t * this, hashtable_entry_t * entry)
+{
+    hashtable_entry_t * bucket = (hashtable_entry_t *) ((char *) this->table + this->entry_size * (entry->hash % this->table_size)),
+                      * p = bucket,
+                      * prev = NULL,
+                      * next;
+    
+    while (p && p->is_occupied)
+    {
+        if (p->hash == entry->hash && this->entry_cmp(p, entry, this->entry_cmp_state) == 0)
+            break;
+        
+        prev = p;
+        p = p->next;
+    }
+    
+    if (!p || !p->is_occupied)
+        return 0;
+    
+    memcpy(entry, p, this->entry_size);
+    
+    if (prev)
+    {
+        prev->next = p->next;
+        free(p);
+    }
+    else if ((next = bucket->next))
+    {
+        /* the bucket itself can't be unlinked, the next entry moves into it */
+        memcpy(bucket, next, this->entry_size);
+        free(next);
+    }
+    else
+        bucket->is_occupied = 0;
+    
+    this->size--;
+    
+    return 1;
+}
+
+static void hashtable_prefetch_home(hashtable_t * this, hashtable_entry_t * entry)
+{
+    hashtable_prefetch((char *) this->table + this->entry_size * (entry->hash % this->table_size));
+}
+
+#endif /* HASHTABLE_BACKEND == HASHTABLE_BACKEND_LIST */
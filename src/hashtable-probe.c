@@ -1,14 +1,54 @@
-#include "lib/hashtable-probe.h"
+#include "lib/hashtable.h"
+
+/* only compiled when this is the backend picked in lib/hashtable.h */
+#if HASHTABLE_BACKEND == HASHTABLE_BACKEND_PROBE
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-int num_probes = 0, num_resize = 0;
+#define HASHTABLE_POW2_MIN_BITS 2
+
+#if HASHTABLE_PROBE_POW2
+#define hashtable_home_idx(ht, hash)    ((hash) & (ht)->mask)
+#define hashtable_next_idx(ht, idx)     (((idx) + 1) & (ht)->mask)
+#define hashtable_prev_idx(ht, idx)     (((idx) - 1) & (ht)->mask)
+#else
+#define hashtable_home_idx(ht, hash)    ((hash) % (ht)->table_size)
+#define hashtable_next_idx(ht, idx)     ((idx) + 1 == (ht)->table_size ? 0 : (idx) + 1)
+#define hashtable_prev_idx(ht, idx)     ((idx) == 0 ? (ht)->table_size - 1 : (idx) - 1)
+#endif
+
+#define hashtable_get_entry(ht, idx) ((hashtable_entry_t *) ((char *) (ht)->table + (ht)->entry_size * (idx)))
 
+/* probe distance + 1 of the slot, 0 if it is empty */
+#if HASHTABLE_PROBE_SOA
+#define hashtable_slot_dist(ht, idx)        ((ht)->meta[idx].dist)
+#define hashtable_slot_match(ht, idx, fp)   ((ht)->meta[idx].fingerprint == (fp))
+#else
+#define hashtable_slot_dist(ht, idx)        (hashtable_get_entry(ht, idx)->is_occupied)
+#define hashtable_slot_match(ht, idx, fp)   1
+#endif
 
-#define hashtable_get_entry(ht, idx) ht->table + ((ht->entry_size * (idx)) % (ht->table_size * ht->entry_size))
-#define hashtable_should_resize(ht) if ((float) ht->size / ht->table_size >= HASHTABLE_LOAD_FACTOR) hashtable_resize(ht);
+#define hashtable_entry_match(ht, idx, entry) \
+    (hashtable_get_entry(ht, idx)->hash == (entry)->hash \
+        && (ht)->entry_cmp(hashtable_get_entry(ht, idx), entry, (ht)->entry_cmp_state) == 0)
 
+#if defined(__GNUC__) || defined(__clang__)
+#define hashtable_prefetch(addr) __builtin_prefetch(addr)
+#else
+#define hashtable_prefetch(addr)
+#endif
+#define hashtable_batch_entry(ht, entries, i) ((hashtable_entry_t *) ((char *) (entries) + (ht)->entry_size * (i)))
+#define hashtable_should_resize(ht) if ((ht)->size >= (ht)->resize_at) hashtable_resize(ht);
+
+#if HASHTABLE_PROBE_POW2
+#define hashtable_idx_size(prime_idx) (1UL << ((prime_idx) + HASHTABLE_POW2_MIN_BITS))
+#else
+#define hashtable_idx_size(prime_idx) prime_doubles[prime_idx]
+#endif
+
+#if !HASHTABLE_PROBE_POW2
 static unsigned long prime_doubles[] = {
   3,
   7,
@@ -91,71 +131,163 @@ static unsigned long prime_doubles[] = {
 //     1767646624268779,
 //     3535293248537579
 };
+#endif
 
-static void * hashtable_probe(hashtable_t *, hashtable_entry_t * entry, int find);
+static hashtable_entry_t * hashtable_place(hashtable_t *, unsigned long idx, hashtable_entry_t * entry, int dist);
+static void hashtable_move_slot(hashtable_t *, unsigned long dst, unsigned long src);
+static void hashtable_prefetch_home(hashtable_t *, hashtable_entry_t * entry);
 static void hashtable_resize(hashtable_t *);
+static void hashtable_resize_to(hashtable_t *, int prime_idx);
+static void hashtable_set_size(hashtable_t *);
+static unsigned long hashtable_capacity(unsigned long table_size);
+static void hashtable_alloc(hashtable_t *);
+
+/* hashtable_probe, hashtable_shift and hashtable_remove */
+HASHTABLE_PROBE_CORE(static, hashtable, hashtable_t, hashtable_entry_t *, HASHTABLE_PROBE_ROBIN_HOOD,
+    hashtable_home_idx, hashtable_next_idx, hashtable_prev_idx, hashtable_slot_dist, hashtable_slot_match,
+    hashtable_entry_match, hashtable_move_slot, hashtable_count_probe)
 
-hashtable_t * hashtable_create(int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state)
+hashtable_t * hashtable_create(int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
 {
     hashtable_t * this = malloc(sizeof(hashtable_t));
     
-    hashtable_init(this, entry_size, entry_cmp, entry_cmp_state); 
+    hashtable_init(this, entry_size, entry_cmp, entry_cmp_state, hash_type, hash_seed); 
     return this;
 }
 
-void hashtable_init(hashtable_t * this, int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state)
+void hashtable_init(hashtable_t * this, int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
 {
     this->size              = 0;
     this->prime_idx         = 0;
     this->entry_size        = entry_size;
     this->entry_cmp         = entry_cmp;
     this->entry_cmp_state   = entry_cmp_state;
-    this->table_size        = prime_doubles[this->prime_idx];
+    this->hash_type         = hash_type;
     
-    num_probes = 0;
-    num_resize = 0;
+    /* every table gets its own seed so colliding keys can't be precomputed */
+    if (hash_seed)
+        this->hash_seed = *hash_seed;
+    else
+        hash_seed_random(&this->hash_seed);
     
-    /* eager initialize the hashtable data, probably should lazy load instead */
-    this->table = calloc(this->table_size, this->entry_size);
+    hashtable_set_size(this);
+    hashtable_stats_init(this);
+    
+    /* the table is allocated by the first insert */
+    this->table = NULL;
+    this->meta  = NULL;
 }
 
 void * hashtable_lookup_entry(hashtable_t * this, void * entry, hashtable_lookup_t lu_type)
 {
     unsigned long idx;
+    int dist, found;
     hashtable_entry_t * ht_entry;
 
+    if (!this->table)
+    {
+        /* nothing to find until the first insert allocates the table */
+        if (lu_type != HASHTABLE_LOOKUP_INSERT)
+            return NULL;
+        
+        hashtable_alloc(this);
+    }
+
     /* should we resize? */
     hashtable_should_resize(this); /* only resizes if it needs to */
     
-    ht_entry = hashtable_probe(this, entry, 0);
+    idx = hashtable_probe(this, entry, ((hashtable_entry_t *) entry)->hash, 0, &dist, &found);
+    ht_entry = hashtable_get_entry(this, idx);
 
-    /* no matter what, returned the occupied entry */
-    if (ht_entry->is_occupied)
-        return ht_entry;
+    if (found)
+    {
+        if (lu_type != HASHTABLE_LOOKUP_DELETE)
+            return ht_entry;
+        
+        /* hand the removed entry back to the caller, its slot gets refilled */
+        memcpy(entry, ht_entry, this->entry_size);
+        hashtable_remove(this, idx);
+        this->size--;
+        
+        return entry;
+    }
         
     /* if we are looking for a node, and didn't find it, return NULL */
         
     switch (lu_type)
     {
-        case HASHTABLE_LOOKUP_SEARCH:
-            return NULL;
         case HASHTABLE_LOOKUP_INSERT:
-            memcpy(ht_entry, entry, this->entry_size);
-            ht_entry->is_occupied  = 1;
             this->size++;
-            break;
-        case HASHTABLE_LOOKUP_DELETE:
-            ht_entry->is_occupied = 0;
-            this->size--;
-            break;
+            return hashtable_place(this, idx, entry, dist);
+        default:
+            return NULL;
     }
+}
+
+int hashtable_lookup_batch(hashtable_t * this, void * entries, int num, void ** results)
+{
+    int i,
+        found = 0;
     
-    return ht_entry;
+    if (!this->table)
+    {
+        memset(results, 0, num * sizeof(void *));
+        return 0;
+    }
+    
+    for (i = 0; i < num && i < HASHTABLE_PREFETCH_DISTANCE; i++)
+        hashtable_prefetch_home(this, hashtable_batch_entry(this, entries, i));
+    
+    for (i = 0; i < num; i++)
+    {
+        if (i + HASHTABLE_PREFETCH_DISTANCE < num)
+            hashtable_prefetch_home(this, hashtable_batch_entry(this, entries, i + HASHTABLE_PREFETCH_DISTANCE));
+        
+        results[i] = hashtable_lookup_entry(this, hashtable_batch_entry(this, entries, i), HASHTABLE_LOOKUP_SEARCH);
+        
+        if (results[i])
+            found++;
+    }
+    
+    return found;
+}
+
+void hashtable_reserve(hashtable_t * this, unsigned long count)
+{
+    int prime_idx = this->prime_idx;
+    
+    while (count >= hashtable_capacity(hashtable_idx_size(prime_idx)))
+        prime_idx++;
+    
+    if (prime_idx != this->prime_idx)
+        hashtable_resize_to(this, prime_idx);
+}
+
+void hashtable_shrink_to_fit(hashtable_t * this)
+{
+    int prime_idx = 0;
+    
+    if (this->size == 0)
+    {
+        hashtable_free(this);
+        this->prime_idx = 0;
+        this->table     = NULL;
+        this->meta      = NULL;
+        hashtable_set_size(this);
+        return;
+    }
+    
+    while (this->size >= hashtable_capacity(hashtable_idx_size(prime_idx)))
+        prime_idx++;
+    
+    if (prime_idx < this->prime_idx)
+        hashtable_resize_to(this, prime_idx);
 }
 
 void hashtable_free(hashtable_t * this)
 {
     free(this->table);
+    free(this->meta);
 }
 
 void hashtable_destroy(hashtable_t * this)
@@ -164,6 +296,57 @@ void hashtable_destroy(hashtable_t * this)
     free(this);
 }
 
+unsigned long hashtable_memory_usage(hashtable_t * this)
+{
+    unsigned long bytes = this->table_size * this->entry_size;
+    
+    if (!this->table)
+        return 0;
+    
+#if HASHTABLE_PROBE_SOA
+    bytes += this->table_size * sizeof(hashtable_meta_t);
+#endif
+    
+    return bytes;
+}
+
+void hashtable_stats(hashtable_t * this, hashtable_stats_t * stats)
+{
+    unsigned long i;
+    
+    hashtable_stats_counters(this, stats);
+    
+    stats->size         = this->size;
+    stats->table_size   = this->table_size;
+    stats->load_factor  = (double) this->size / this->table_size;
+    stats->bytes        = hashtable_memory_usage(this);
+    stats->max_chain    = 0;
+    
+    if (!this->table)
+        return;
+    
+    /* the distance kept per slot is already the number of slots a lookup looks at */
+    for (i = 0; i < this->table_size; i++)
+    {
+        if ((unsigned long) hashtable_slot_dist(this, i) > stats->max_chain)
+            stats->max_chain = hashtable_slot_dist(this, i);
+    }
+}
+
+void * hashtable_next(hashtable_t * this, hashtable_cursor_t * cursor)
+{
+    if (!this->table)
+        return NULL;
+
+    for (; cursor->idx < this->table_size; cursor->idx++)
+    {
+        if (hashtable_slot_dist(this, cursor->idx))
+            return hashtable_get_entry(this, cursor->idx++);
+    }
+
+    return NULL;
+}
+
 void hashtable_print(hashtable_t * this)
 {
     unsigned long i, occupied = 0;
@@ -175,14 +358,17 @@ void hashtable_print(hashtable_t * this)
     
     printf("table size = %ld\n", this->size);
     
-    for (i = 0; i < this->table_size * this->entry_size; i += this->entry_size)
+    if (!this->table)
+        return;
+    
+    for (i = 0; i < this->table_size; i++)
     {
-        entry = (hashtable_entry_t *) ((char *)this->table + i);
+        entry = hashtable_get_entry(this, i);
         
-        if (entry->is_occupied)
+        if (hashtable_slot_dist(this, i))
             occupied++;
         
-        printf(fmt, entry->is_occupied, entry->hash);
+        printf(fmt, hashtable_slot_dist(this, i), entry->hash);
     }
     
     printf("occupied size = %ld\n", occupied);
@@ -190,58 +376,143 @@ void hashtable_print(hashtable_t * this)
 
 static void hashtable_resize(hashtable_t * this)
 {
-    unsigned long old_size = this->table_size * this->entry_size,
-                  i;
+    hashtable_resize_to(this, this->prime_idx + 1);
+}
+
+/*
+ * re indexes the entries into the table for prime_idx. Before the first
+ * insert only the size is changed.
+ */
+static void hashtable_resize_to(hashtable_t * this, int prime_idx)
+{
+    unsigned long old_table_size = this->table_size,
+                  i,
+                  idx;
+    int dist, found;
     void * old_table = this->table;
-    hashtable_entry_t * old_entry,
-                      * new_entry;
+    hashtable_meta_t * old_meta = this->meta;
+    hashtable_entry_t * old_entry;
 
-    this->prime_idx++;
-    //num_resize++;
+    this->prime_idx = prime_idx;
+    
+    hashtable_set_size(this);
+    
+    if (!old_table)
+        return;
+    
+    hashtable_count_resize(this);
+    hashtable_resize_begin(this);
     
     /* TODO - proper error handling */
     
-    this->table_size = prime_doubles[this->prime_idx];
-    this->table = calloc(this->table_size, this->entry_size);
+    hashtable_alloc(this);
     
     /* re index the entries */
-    for (i = 0; i < old_size; i += this->entry_size)
+    for (i = 0; i < old_table_size; i++)
     {
-        old_entry = (hashtable_entry_t * ) ((char *)old_table + i);
+        old_entry = (hashtable_entry_t * ) ((char *)old_table + i * this->entry_size);
+#if HASHTABLE_PROBE_SOA
+        if (old_meta[i].dist == 0)
+#else
         if (old_entry->is_occupied == 0)
+#endif
             continue;
         
-        new_entry = hashtable_probe(this, old_entry, 1);
-        memcpy(new_entry, old_entry, this->entry_size);
+        idx = hashtable_probe(this, old_entry, old_entry->hash, 1, &dist, &found);
+        hashtable_place(this, idx, old_entry, dist);
     }
     
     free(old_table);
+    free(old_meta);
+    
+    hashtable_resize_end(this);
 }
 
-static void * hashtable_probe(hashtable_t * this, hashtable_entry_t * entry, int only_empty)
+/*
+ * allocates the table for the current size. With the metadata split out the
+ * entries are only read once their slot is in use, so they aren't cleared.
+ */
+static void hashtable_alloc(hashtable_t * this)
 {
-    int i = 0;
-    unsigned long idx = entry->hash % this->table_size,
-                  tmp_idx;
-    hashtable_entry_t * ht_entry;
+#if HASHTABLE_PROBE_SOA
+    this->table = malloc(this->table_size * this->entry_size);
+    this->meta  = calloc(this->table_size, sizeof(hashtable_meta_t));
+#else
+    this->table = calloc(this->table_size, this->entry_size);
+    this->meta  = NULL;
+#endif
+}
 
-    while (1)
-    {
-        tmp_idx = (idx + i) % this->table_size; /* linear */
-        //idx = tmp_idx;
-        ht_entry = (hashtable_entry_t *) ((this->entry_size * tmp_idx) + (char *) this->table);
+/*
+ * sets the table size, mask and resize threshold for the current prime_idx,
+ * so neither probing nor the resize check ever divide
+ */
+static void hashtable_set_size(hashtable_t * this)
+{
+    this->table_size    = hashtable_idx_size(this->prime_idx);
+#if HASHTABLE_PROBE_POW2
+    this->mask          = this->table_size - 1;
+#else
+    this->mask          = 0;
+#endif
+    this->resize_at     = hashtable_capacity(this->table_size);
+}
 
-        if (ht_entry->is_occupied == 0)
-            return ht_entry;
+/*
+ * number of entries that trigger a resize of a table of the given size
+ */
+static unsigned long hashtable_capacity(unsigned long table_size)
+{
+    unsigned long resize_at = table_size * HASHTABLE_LOAD_FACTOR;
+    
+    /* always leave an empty slot to end the probe runs */
+    if (resize_at >= table_size)
+        resize_at = table_size - 1;
+    
+    return resize_at;
+}
 
-        /*
-         * We are occupied, check if the hashes and values match,
-         * but only do that if the only_empty parameter is not set.
-         */
-        if (!only_empty && ht_entry->hash == entry->hash && this->entry_cmp(ht_entry, entry, this->entry_cmp_state))
-            return ht_entry;
-            
-        i++;
-        //num_probes++;
-    }
+/*
+ * puts the entry at idx, where hashtable_probe said it goes
+ */
+static hashtable_entry_t * hashtable_place(hashtable_t * this, unsigned long idx, hashtable_entry_t * entry, int dist)
+{
+    hashtable_entry_t * dst;
+
+    hashtable_shift(this, idx);
+
+    dst = hashtable_get_entry(this, idx);
+    memcpy(dst, entry, this->entry_size);
+#if HASHTABLE_PROBE_SOA
+    this->meta[idx].fingerprint = hashtable_probe_fingerprint(entry->hash);
+#endif
+    hashtable_slot_dist(this, idx) = dist + 1;
+
+    return dst;
+}
+
+/*
+ * copies the entry and its metadata from slot src to dst
+ */
+static void hashtable_move_slot(hashtable_t * this, unsigned long dst, unsigned long src)
+{
+    memcpy(hashtable_get_entry(this, dst), hashtable_get_entry(this, src), this->entry_size);
+#if HASHTABLE_PROBE_SOA
+    this->meta[dst] = this->meta[src];
+#endif
+}
+
+/*
+ * a hit reads the entry as well as the metadata, so both are prefetched
+ */
+static void hashtable_prefetch_home(hashtable_t * this, hashtable_entry_t * entry)
+{
+    unsigned long idx = hashtable_home_idx(this, entry->hash);
+    
+#if HASHTABLE_PROBE_SOA
+    hashtable_prefetch(this->meta + idx);
+#endif
+    hashtable_prefetch(hashtable_get_entry(this, idx));
 }
+
+#endif /* HASHTABLE_BACKEND == HASHTABLE_BACKEND_PROBE */
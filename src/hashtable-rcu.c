@@ -0,0 +1,422 @@
+#include "lib/hashtable-rcu.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * everything readers see is published with a release store and read with
+ * an acquire load, so an entry or table is complete before it's reachable
+ */
+#define hashtable_rcu_load(p)       __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define hashtable_rcu_store(p, v)   __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+#define hashtable_rcu_hash(e) (((hashtable_entry_t *) (e))->hash)
+
+/* the garbage header allocated in front of an entry copy */
+#define hashtable_rcu_entry_garbage(e) (((hashtable_rcu_garbage_t *) (e)) - 1)
+
+/* marks the slot of a deleted entry, searches probe past it */
+static char hashtable_rcu_deleted_marker;
+#define HASHTABLE_RCU_DELETED ((void *) &hashtable_rcu_deleted_marker)
+
+static hashtable_rcu_table_t * hashtable_rcu_table_alloc(unsigned long table_size);
+static unsigned long hashtable_rcu_find(hashtable_rcu_t * this, hashtable_rcu_table_t * table, void * entry, int * found);
+static int hashtable_rcu_resize(hashtable_rcu_t * this);
+static void hashtable_rcu_retire(hashtable_rcu_t * this, hashtable_rcu_garbage_t * garbage);
+static void hashtable_rcu_reclaim(hashtable_rcu_t * this);
+
+hashtable_rcu_t * hashtable_rcu_create(int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
+{
+    hashtable_rcu_t * this = (hashtable_rcu_t *) malloc(sizeof(hashtable_rcu_t));
+
+    hashtable_rcu_init(this, entry_size, entry_cmp, entry_cmp_state, hash_type, hash_seed);
+
+    return this;
+}
+
+void hashtable_rcu_init(hashtable_rcu_t * this, int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
+{
+    this->table             = NULL;
+    this->size              = 0;
+    this->epoch             = 1; /* 0 marks offline readers */
+    this->entry_size        = entry_size;
+    this->entry_cmp         = entry_cmp;
+    this->entry_cmp_state   = entry_cmp_state;
+    this->hash_type         = hash_type;
+    this->readers           = NULL;
+    this->garbage           = NULL;
+
+    if (hash_seed)
+        this->hash_seed = *hash_seed;
+    else
+        hash_seed_random(&this->hash_seed);
+
+    pthread_mutex_init(&this->write_lock, NULL);
+}
+
+void * hashtable_rcu_search(hashtable_rcu_t * this, void * entry)
+{
+    hashtable_rcu_table_t * table = hashtable_rcu_load(this->table);
+    unsigned long hash = hashtable_rcu_hash(entry),
+                  idx;
+    void * slot;
+
+    if (!table)
+        return NULL;
+
+    /* the load factor keeps some slots empty, so this always ends */
+    for (idx = hash & table->mask; ; idx = (idx + 1) & table->mask)
+    {
+        slot = hashtable_rcu_load(table->slots[idx]);
+
+        if (!slot)
+            return NULL;
+
+        if (slot != HASHTABLE_RCU_DELETED && hashtable_rcu_hash(slot) == hash && this->entry_cmp(slot, entry, this->entry_cmp_state) == 0)
+            return slot;
+    }
+}
+
+int hashtable_rcu_insert(hashtable_rcu_t * this, void * entry)
+{
+    hashtable_rcu_garbage_t * garbage = (hashtable_rcu_garbage_t *) malloc(sizeof(hashtable_rcu_garbage_t) + this->entry_size);
+    void * copy,
+         * old;
+    unsigned long idx = 0;
+    int found = 0;
+
+    if (garbage == NULL)
+        return 0;
+
+    copy = garbage + 1;
+    memcpy(copy, entry, this->entry_size);
+
+    pthread_mutex_lock(&this->write_lock);
+
+    if (this->table)
+        idx = hashtable_rcu_find(this, this->table, entry, &found);
+
+    if (found)
+    {
+        /* readers see either the old or the new entry, never a mix */
+        old = this->table->slots[idx];
+        hashtable_rcu_store(this->table->slots[idx], copy);
+        hashtable_rcu_retire(this, hashtable_rcu_entry_garbage(old));
+    }
+    else
+    {
+        if (!this->table || this->table->used + 1 > this->table->table_size * HASHTABLE_RCU_LOAD_FACTOR)
+        {
+            /* nothing has been published yet, the copy is simply dropped */
+            if (!hashtable_rcu_resize(this))
+            {
+                pthread_mutex_unlock(&this->write_lock);
+                free(garbage);
+                return 0;
+            }
+
+            idx = hashtable_rcu_find(this, this->table, entry, &found);
+        }
+
+        /* reusing a deletion marker doesn't use up another slot */
+        if (!this->table->slots[idx])
+            this->table->used++;
+
+        hashtable_rcu_store(this->table->slots[idx], copy);
+        this->size++;
+    }
+
+    hashtable_rcu_reclaim(this);
+
+    pthread_mutex_unlock(&this->write_lock);
+
+    return 1;
+}
+
+int hashtable_rcu_delete(hashtable_rcu_t * this, void * entry)
+{
+    void * old;
+    unsigned long idx;
+    int found = 0;
+
+    pthread_mutex_lock(&this->write_lock);
+
+    if (this->table)
+    {
+        idx = hashtable_rcu_find(this, this->table, entry, &found);
+
+        if (found)
+        {
+            /* the marker keeps the probe sequences of other entries intact */
+            old = this->table->slots[idx];
+            hashtable_rcu_store(this->table->slots[idx], HASHTABLE_RCU_DELETED);
+            this->size--;
+            hashtable_rcu_retire(this, hashtable_rcu_entry_garbage(old));
+        }
+    }
+
+    hashtable_rcu_reclaim(this);
+
+    pthread_mutex_unlock(&this->write_lock);
+
+    return found;
+}
+
+hashtable_rcu_reader_t * hashtable_rcu_register(hashtable_rcu_t * this)
+{
+    hashtable_rcu_reader_t * reader = (hashtable_rcu_reader_t *) malloc(sizeof(hashtable_rcu_reader_t));
+
+    if (reader == NULL)
+        return NULL;
+
+    /* writers only look at the readers while holding the lock */
+    pthread_mutex_lock(&this->write_lock);
+
+    reader->epoch   = this->epoch;
+    reader->next    = this->readers;
+    this->readers   = reader;
+
+    pthread_mutex_unlock(&this->write_lock);
+
+    return reader;
+}
+
+void hashtable_rcu_unregister(hashtable_rcu_t * this, hashtable_rcu_reader_t * reader)
+{
+    hashtable_rcu_reader_t ** link;
+
+    pthread_mutex_lock(&this->write_lock);
+
+    for (link = &this->readers; *link; link = &(*link)->next)
+    {
+        if (*link == reader)
+        {
+            *link = reader->next;
+            break;
+        }
+    }
+
+    /* the reader may have been the one holding things back */
+    hashtable_rcu_reclaim(this);
+
+    pthread_mutex_unlock(&this->write_lock);
+
+    free(reader);
+}
+
+void hashtable_rcu_quiescent(hashtable_rcu_t * this, hashtable_rcu_reader_t * reader)
+{
+    /*
+     * the release orders the reader's earlier searches before the store, a
+     * writer that sees the new epoch knows they're done
+     */
+    hashtable_rcu_store(reader->epoch, hashtable_rcu_load(this->epoch));
+}
+
+void hashtable_rcu_offline(hashtable_rcu_t * this, hashtable_rcu_reader_t * reader)
+{
+    (void) this; /* only taken to match hashtable_rcu_online */
+
+    hashtable_rcu_store(reader->epoch, 0);
+}
+
+void hashtable_rcu_online(hashtable_rcu_t * this, hashtable_rcu_reader_t * reader)
+{
+    /*
+     * the fence pairs with the one in hashtable_rcu_reclaim, either the
+     * writer sees the reader online or the reader sees what the writer
+     * unlinked
+     */
+    __atomic_store_n(&reader->epoch, hashtable_rcu_load(this->epoch), __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void hashtable_rcu_free(hashtable_rcu_t * this)
+{
+    hashtable_rcu_reader_t * reader;
+    unsigned long idx;
+    void * slot;
+
+    if (this->table)
+    {
+        for (idx = 0; idx < this->table->table_size; idx++)
+        {
+            slot = this->table->slots[idx];
+
+            if (slot && slot != HASHTABLE_RCU_DELETED)
+                free(hashtable_rcu_entry_garbage(slot));
+        }
+
+        free(this->table);
+        this->table = NULL;
+    }
+
+    /* with no readers left everything retired is freed */
+    while ((reader = this->readers))
+    {
+        this->readers = reader->next;
+        free(reader);
+    }
+
+    hashtable_rcu_reclaim(this);
+
+    this->size = 0;
+    pthread_mutex_destroy(&this->write_lock);
+}
+
+void hashtable_rcu_destroy(hashtable_rcu_t * this)
+{
+    hashtable_rcu_free(this);
+    free(this);
+}
+
+static hashtable_rcu_table_t * hashtable_rcu_table_alloc(unsigned long table_size)
+{
+    hashtable_rcu_table_t * table = (hashtable_rcu_table_t *) calloc(1, sizeof(hashtable_rcu_table_t) + table_size * sizeof(void *));
+
+    if (table == NULL)
+        return NULL;
+
+    table->table_size   = table_size;
+    table->mask         = table_size - 1;
+    table->used         = 0;
+    table->slots        = (void **) (table + 1);
+
+    return table;
+}
+
+/*
+ * writer side probe, returns the slot of the matching entry or else the
+ * first free slot on the entry's probe sequence. Only called with the
+ * write lock held, so the slots can't change underneath it.
+ */
+static unsigned long hashtable_rcu_find(hashtable_rcu_t * this, hashtable_rcu_table_t * table, void * entry, int * found)
+{
+    unsigned long hash = hashtable_rcu_hash(entry),
+                  idx,
+                  free_idx = table->table_size;
+    void * slot;
+
+    for (idx = hash & table->mask; ; idx = (idx + 1) & table->mask)
+    {
+        slot = table->slots[idx];
+
+        if (!slot)
+        {
+            *found = 0;
+            return free_idx < table->table_size ? free_idx : idx;
+        }
+
+        if (slot == HASHTABLE_RCU_DELETED)
+        {
+            if (free_idx == table->table_size)
+                free_idx = idx;
+        }
+        else if (hashtable_rcu_hash(slot) == hash && this->entry_cmp(slot, entry, this->entry_cmp_state) == 0)
+        {
+            *found = 1;
+            return idx;
+        }
+    }
+}
+
+/*
+ * builds a new table sized for twice the entries plus one, without the
+ * deletion markers, and swaps it in. The entries are shared with the old
+ * table, only the old slot array is retired. Returns 0 and keeps the old
+ * table when out of memory.
+ */
+static int hashtable_rcu_resize(hashtable_rcu_t * this)
+{
+    hashtable_rcu_table_t * old = this->table,
+                          * table;
+    unsigned long table_size = HASHTABLE_RCU_MIN_SIZE,
+                  idx,
+                  new_idx;
+    void * slot;
+
+    while (table_size * HASHTABLE_RCU_LOAD_FACTOR < 2 * (this->size + 1))
+        table_size <<= 1;
+
+    table = hashtable_rcu_table_alloc(table_size);
+
+    if (table == NULL)
+        return 0;
+
+    /* nobody can see the new table yet, plain stores are enough */
+    if (old)
+    {
+        for (idx = 0; idx < old->table_size; idx++)
+        {
+            slot = old->slots[idx];
+
+            if (!slot || slot == HASHTABLE_RCU_DELETED)
+                continue;
+
+            for (new_idx = hashtable_rcu_hash(slot) & table->mask; table->slots[new_idx]; new_idx = (new_idx + 1) & table->mask)
+                ;
+
+            table->slots[new_idx] = slot;
+        }
+    }
+
+    table->used = this->size;
+
+    hashtable_rcu_store(this->table, table);
+
+    if (old)
+        hashtable_rcu_retire(this, &old->garbage);
+
+    return 1;
+}
+
+/*
+ * queues something unlinked from the table, it's freed once every reader
+ * has been quiescent in a later epoch
+ */
+static void hashtable_rcu_retire(hashtable_rcu_t * this, hashtable_rcu_garbage_t * garbage)
+{
+    garbage->epoch  = this->epoch;
+    garbage->next   = this->garbage;
+    this->garbage   = garbage;
+
+    /* a reader that loads the new epoch also sees the unlink before it */
+    hashtable_rcu_store(this->epoch, this->epoch + 1);
+}
+
+/*
+ * frees the retired pointers no reader can hold anymore. Called with the
+ * write lock held.
+ */
+static void hashtable_rcu_reclaim(hashtable_rcu_t * this)
+{
+    hashtable_rcu_reader_t * reader;
+    hashtable_rcu_garbage_t ** link,
+                            * garbage;
+    unsigned long min_epoch = this->epoch,
+                  epoch;
+
+    if (!this->garbage)
+        return;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for (reader = this->readers; reader; reader = reader->next)
+    {
+        epoch = hashtable_rcu_load(reader->epoch);
+
+        if (epoch && epoch < min_epoch)
+            min_epoch = epoch;
+    }
+
+    for (link = &this->garbage; (garbage = *link); )
+    {
+        if (garbage->epoch < min_epoch)
+        {
+            *link = garbage->next;
+            free(garbage);
+        }
+        else
+            link = &garbage->next;
+    }
+}
@@ -0,0 +1,542 @@
+#include "lib/hashtable.h"
+
+/* only compiled when this is the backend picked in lib/hashtable.h */
+#if HASHTABLE_BACKEND == HASHTABLE_BACKEND_SWISS
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#if HASHTABLE_SWISS_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * control tags. A full slot holds the low 7 bits of its hash (h2), the
+ * empty and deleted markers both have the high bit set.
+ */
+#define CTRL_EMPTY      0x80
+#define CTRL_DELETED    0xfe
+
+#define GROUP_WIDTH     HASHTABLE_SWISS_GROUP_WIDTH
+#define HASHTABLE_MIN_BITS 4 /* one group */
+
+/* h1 picks the starting group, h2 is stored in the control tag */
+#define hashtable_h1(hash) ((hash) >> 7)
+#define hashtable_h2(hash) ((unsigned char) ((hash) & 0x7f))
+
+#define hashtable_get_entry(ht, idx) ((hashtable_entry_t *) ((char *) (ht)->table + (ht)->entry_size * (idx)))
+#if defined(__GNUC__) || defined(__clang__)
+#define hashtable_prefetch(addr) __builtin_prefetch(addr)
+#else
+#define hashtable_prefetch(addr)
+#endif
+#define hashtable_batch_entry(ht, entries, i) ((hashtable_entry_t *) ((char *) (entries) + (ht)->entry_size * (i)))
+#define hashtable_resize_at(ht) ((unsigned long) ((ht)->table_size * HASHTABLE_LOAD_FACTOR))
+
+typedef unsigned int group_mask_t; /* one bit per slot of a group */
+
+static void hashtable_set_size(hashtable_t *);
+static void hashtable_alloc(hashtable_t *);
+static void hashtable_resize(hashtable_t *);
+static void hashtable_resize_to(hashtable_t *, int prime_idx);
+static int hashtable_find(hashtable_t *, hashtable_entry_t * entry, unsigned long * idx);
+static unsigned long hashtable_find_free(hashtable_t *, unsigned long hash);
+static void hashtable_set_ctrl(hashtable_t *, unsigned long idx, unsigned char c);
+static void hashtable_prefetch_home(hashtable_t *, hashtable_entry_t * entry);
+
+/*
+ * group matching, each returns a mask with a bit set for every slot of the
+ * 16 tags at ctrl that matches
+ */
+#if HASHTABLE_SWISS_SSE2
+
+static group_mask_t group_match(const unsigned char * ctrl, unsigned char tag)
+{
+    __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) tag)));
+}
+
+/* empty or deleted, the only tags with the high bit set */
+static group_mask_t group_match_free(const unsigned char * ctrl)
+{
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) ctrl));
+}
+
+#else
+
+static group_mask_t group_match(const unsigned char * ctrl, unsigned char tag)
+{
+    group_mask_t m = 0;
+    int i;
+
+    for (i = 0; i < GROUP_WIDTH; i++)
+        m |= (group_mask_t) (ctrl[i] == tag) << i;
+
+    return m;
+}
+
+static group_mask_t group_match_free(const unsigned char * ctrl)
+{
+    group_mask_t m = 0;
+    int i;
+
+    for (i = 0; i < GROUP_WIDTH; i++)
+        m |= (group_mask_t) (ctrl[i] >> 7) << i;
+
+    return m;
+}
+
+#endif
+
+#define group_match_empty(ctrl) group_match(ctrl, CTRL_EMPTY)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define group_trailing_zeros(m) ((m) ? __builtin_ctz(m) : GROUP_WIDTH)
+#define group_leading_zeros(m)  ((m) ? __builtin_clz(m) - (int) (sizeof(group_mask_t) * 8 - GROUP_WIDTH) : GROUP_WIDTH)
+#else
+static int group_trailing_zeros(group_mask_t m)
+{
+    int n = 0;
+
+    while (n < GROUP_WIDTH && !(m & (1u << n)))
+        n++;
+
+    return n;
+}
+
+static int group_leading_zeros(group_mask_t m)
+{
+    int n = 0;
+
+    while (n < GROUP_WIDTH && !(m & (1u << (GROUP_WIDTH - 1 - n))))
+        n++;
+
+    return n;
+}
+#endif
+
+hashtable_t * hashtable_create(int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
+{
+    hashtable_t * this = malloc(sizeof(hashtable_t));
+
+    hashtable_init(this, entry_size, entry_cmp, entry_cmp_state, hash_type, hash_seed);
+
+    return this;
+}
+
+void hashtable_init(hashtable_t * this, int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
+{
+    this->size              = 0;
+    this->prime_idx         = HASHTABLE_MIN_BITS;
+    this->entry_size        = entry_size;
+    this->entry_cmp         = entry_cmp;
+    this->entry_cmp_state   = entry_cmp_state;
+    this->hash_type         = hash_type;
+
+    /* every table gets its own seed so colliding keys can't be precomputed */
+    if (hash_seed)
+        this->hash_seed = *hash_seed;
+    else
+        hash_seed_random(&this->hash_seed);
+
+    hashtable_stats_init(this);
+
+    /* the table is allocated by the first insert */
+    this->table = NULL;
+    this->ctrl  = NULL;
+    hashtable_set_size(this);
+}
+
+void * hashtable_lookup_entry(hashtable_t * this, void * entry, hashtable_lookup_t lu_type)
+{
+    unsigned long idx,
+                  before;
+    group_mask_t empty_before,
+                 empty_after;
+    hashtable_entry_t * ht_entry;
+
+    if (!this->table)
+    {
+        /* nothing to find until the first insert allocates the table */
+        if (lu_type != HASHTABLE_LOOKUP_INSERT)
+            return NULL;
+
+        hashtable_alloc(this);
+    }
+
+    if (hashtable_find(this, entry, &idx))
+    {
+        ht_entry = hashtable_get_entry(this, idx);
+
+        if (lu_type != HASHTABLE_LOOKUP_DELETE)
+            return ht_entry;
+
+        memcpy(entry, ht_entry, this->entry_size);
+
+        /*
+         * The slot can go straight back to empty if no probe ever had to
+         * step past it, i.e. there was never a full group of used slots
+         * around it. Otherwise it becomes a tombstone.
+         */
+        before = (idx - GROUP_WIDTH) & this->mask;
+        empty_before = group_match_empty(this->ctrl + before);
+        empty_after = group_match_empty(this->ctrl + idx);
+
+        if (empty_before && empty_after && group_trailing_zeros(empty_after) + group_leading_zeros(empty_before) < GROUP_WIDTH)
+        {
+            hashtable_set_ctrl(this, idx, CTRL_EMPTY);
+            this->growth_left++;
+        }
+        else
+        {
+            hashtable_set_ctrl(this, idx, CTRL_DELETED);
+        }
+
+        this->size--;
+
+        return entry;
+    }
+
+    /* if we are looking for a node, and didn't find it, return NULL */
+    if (lu_type != HASHTABLE_LOOKUP_INSERT)
+        return NULL;
+
+    ht_entry = entry;
+    idx = hashtable_find_free(this, ht_entry->hash);
+
+    /* only resize when we would use up an empty slot, reusing tombstones is free */
+    if (this->growth_left == 0 && this->ctrl[idx] == CTRL_EMPTY)
+    {
+        hashtable_resize(this);
+        idx = hashtable_find_free(this, ht_entry->hash);
+    }
+
+    if (this->ctrl[idx] == CTRL_EMPTY)
+        this->growth_left--;
+
+    hashtable_set_ctrl(this, idx, hashtable_h2(ht_entry->hash));
+
+    ht_entry = hashtable_get_entry(this, idx);
+    memcpy(ht_entry, entry, this->entry_size);
+    ht_entry->is_occupied = 1;
+    this->size++;
+
+    return ht_entry;
+}
+
+int hashtable_lookup_batch(hashtable_t * this, void * entries, int num, void ** results)
+{
+    int i,
+        found = 0;
+
+    if (!this->table)
+    {
+        memset(results, 0, num * sizeof(void *));
+        return 0;
+    }
+
+    for (i = 0; i < num && i < HASHTABLE_PREFETCH_DISTANCE; i++)
+        hashtable_prefetch_home(this, hashtable_batch_entry(this, entries, i));
+
+    for (i = 0; i < num; i++)
+    {
+        if (i + HASHTABLE_PREFETCH_DISTANCE < num)
+            hashtable_prefetch_home(this, hashtable_batch_entry(this, entries, i + HASHTABLE_PREFETCH_DISTANCE));
+
+        results[i] = hashtable_lookup_entry(this, hashtable_batch_entry(this, entries, i), HASHTABLE_LOOKUP_SEARCH);
+
+        if (results[i])
+            found++;
+    }
+
+    return found;
+}
+
+void hashtable_reserve(hashtable_t * this, unsigned long count)
+{
+    int prime_idx = this->prime_idx;
+
+    while (count > (unsigned long) ((1UL << prime_idx) * HASHTABLE_LOAD_FACTOR))
+        prime_idx++;
+
+    if (prime_idx != this->prime_idx)
+        hashtable_resize_to(this, prime_idx);
+}
+
+void hashtable_shrink_to_fit(hashtable_t * this)
+{
+    int prime_idx = HASHTABLE_MIN_BITS;
+
+    if (this->size == 0)
+    {
+        hashtable_free(this);
+        this->prime_idx = HASHTABLE_MIN_BITS;
+        this->table     = NULL;
+        this->ctrl      = NULL;
+        hashtable_set_size(this);
+        return;
+    }
+
+    while (this->size > (unsigned long) ((1UL << prime_idx) * HASHTABLE_LOAD_FACTOR))
+        prime_idx++;
+
+    if (prime_idx < this->prime_idx)
+        hashtable_resize_to(this, prime_idx);
+}
+
+void hashtable_free(hashtable_t * this)
+{
+    free(this->table);
+    free(this->ctrl);
+}
+
+void hashtable_destroy(hashtable_t * this)
+{
+    hashtable_free(this);
+    free(this);
+}
+
+unsigned long hashtable_memory_usage(hashtable_t * this)
+{
+    if (!this->table)
+        return 0;
+
+    return this->table_size * this->entry_size + this->table_size + GROUP_WIDTH;
+}
+
+void hashtable_stats(hashtable_t * this, hashtable_stats_t * stats)
+{
+    unsigned long i,
+                  pos,
+                  stride,
+                  groups;
+    hashtable_entry_t * entry;
+
+    hashtable_stats_counters(this, stats);
+
+    stats->size         = this->size;
+    stats->table_size   = this->table_size;
+    stats->load_factor  = (double) this->size / this->table_size;
+    stats->bytes        = hashtable_memory_usage(this);
+    stats->max_chain    = 0;
+
+    if (!this->table)
+        return;
+
+    /* replays the probe sequence of every entry up to the group holding it */
+    for (i = 0; i < this->table_size; i++)
+    {
+        if (this->ctrl[i] & CTRL_EMPTY)
+            continue;
+
+        entry = hashtable_get_entry(this, i);
+        pos = hashtable_h1(entry->hash) & this->mask;
+
+        for (stride = 0, groups = 1; ((i - pos) & this->mask) >= GROUP_WIDTH; groups++)
+        {
+            stride += GROUP_WIDTH;
+            pos = (pos + stride) & this->mask;
+        }
+
+        if (groups > stats->max_chain)
+            stats->max_chain = groups;
+    }
+}
+
+void * hashtable_next(hashtable_t * this, hashtable_cursor_t * cursor)
+{
+    if (!this->table)
+        return NULL;
+
+    for (; cursor->idx < this->table_size; cursor->idx++)
+    {
+        if (this->ctrl[cursor->idx] < CTRL_EMPTY)
+            return hashtable_get_entry(this, cursor->idx++);
+    }
+
+    return NULL;
+}
+
+void hashtable_print(hashtable_t * this)
+{
+    unsigned long i,
+                  occupied = 0,
+                  deleted = 0;
+
+    if (!this->table)
+        return;
+
+    for (i = 0; i < this->table_size; i++)
+    {
+        if (this->ctrl[i] == CTRL_DELETED)
+            deleted++;
+        else if (this->ctrl[i] != CTRL_EMPTY)
+            occupied++;
+    }
+
+    printf("table size = %ld\n", this->table_size);
+    printf("occupied size = %ld, deleted = %ld, growth left = %ld\n", occupied, deleted, this->growth_left);
+}
+
+/*
+ * sets the table size for 1 << prime_idx slots
+ */
+static void hashtable_set_size(hashtable_t * this)
+{
+    this->table_size    = 1UL << this->prime_idx;
+    this->mask          = this->table_size - 1;
+    this->growth_left   = hashtable_resize_at(this);
+}
+
+/*
+ * allocates empty entry and control arrays for the table size
+ */
+static void hashtable_alloc(hashtable_t * this)
+{
+    /* the tags decide which slots are used, so the entries don't need clearing */
+    this->table = malloc(this->table_size * this->entry_size);
+    this->ctrl  = malloc(this->table_size + GROUP_WIDTH);
+
+    memset(this->ctrl, CTRL_EMPTY, this->table_size + GROUP_WIDTH);
+}
+
+static void hashtable_resize(hashtable_t * this)
+{
+    /* if most of the used slots are tombstones, rebuilding at the same size clears them */
+    if (this->size >= hashtable_resize_at(this) / 2)
+        hashtable_resize_to(this, this->prime_idx + 1);
+    else
+        hashtable_resize_to(this, this->prime_idx);
+}
+
+/*
+ * re indexes the entries into a table of 1 << prime_idx slots. Before the
+ * first insert only the size is changed.
+ */
+static void hashtable_resize_to(hashtable_t * this, int prime_idx)
+{
+    unsigned long old_table_size = this->table_size,
+                  i,
+                  idx;
+    void * old_table = this->table;
+    unsigned char * old_ctrl = this->ctrl;
+    hashtable_entry_t * old_entry;
+
+    this->prime_idx = prime_idx;
+    hashtable_set_size(this);
+
+    if (!old_table)
+        return;
+
+    hashtable_count_resize(this);
+    hashtable_resize_begin(this);
+
+    /* TODO - proper error handling */
+
+    hashtable_alloc(this);
+
+    /* re index the entries */
+    for (i = 0; i < old_table_size; i++)
+    {
+        if (old_ctrl[i] & CTRL_EMPTY)
+            continue;
+
+        old_entry = (hashtable_entry_t *) ((char *) old_table + i * this->entry_size);
+        idx = hashtable_find_free(this, old_entry->hash);
+
+        hashtable_set_ctrl(this, idx, old_ctrl[i]);
+        memcpy(hashtable_get_entry(this, idx), old_entry, this->entry_size);
+        this->growth_left--;
+    }
+
+    free(old_table);
+    free(old_ctrl);
+
+    hashtable_resize_end(this);
+}
+
+/*
+ * Probes group by group with a triangular stride (16, 32, 48... slots),
+ * which visits every group of a power of two table. Only entries whose tag
+ * matches are compared, a group with an empty slot ends the search.
+ */
+static int hashtable_find(hashtable_t * this, hashtable_entry_t * entry, unsigned long * idx)
+{
+    unsigned long pos = hashtable_h1(entry->hash) & this->mask,
+                  stride = 0;
+    unsigned char tag = hashtable_h2(entry->hash);
+    group_mask_t m;
+    hashtable_entry_t * ht_entry;
+
+    while (1)
+    {
+        m = group_match(this->ctrl + pos, tag);
+
+        while (m)
+        {
+            *idx = (pos + group_trailing_zeros(m)) & this->mask;
+            ht_entry = hashtable_get_entry(this, *idx);
+
+            if (ht_entry->hash == entry->hash && this->entry_cmp(ht_entry, entry, this->entry_cmp_state) == 0)
+            {
+                hashtable_count_probe(this, stride / GROUP_WIDTH + 1);
+                return 1;
+            }
+
+            m &= m - 1;
+        }
+
+        if (group_match_empty(this->ctrl + pos))
+        {
+            hashtable_count_probe(this, stride / GROUP_WIDTH + 1);
+            return 0;
+        }
+
+        stride += GROUP_WIDTH;
+        pos = (pos + stride) & this->mask;
+    }
+}
+
+/*
+ * first empty or deleted slot on the probe sequence of the hash
+ */
+static unsigned long hashtable_find_free(hashtable_t * this, unsigned long hash)
+{
+    unsigned long pos = hashtable_h1(hash) & this->mask,
+                  stride = 0;
+    group_mask_t m;
+
+    while (!(m = group_match_free(this->ctrl + pos)))
+    {
+        stride += GROUP_WIDTH;
+        pos = (pos + stride) & this->mask;
+    }
+
+    return (pos + group_trailing_zeros(m)) & this->mask;
+}
+
+/*
+ * sets a control tag, the first group is mirrored after the end of the
+ * table so a group starting near the end can be loaded without wrapping
+ */
+static void hashtable_set_ctrl(hashtable_t * this, unsigned long idx, unsigned char c)
+{
+    this->ctrl[idx] = c;
+
+    if (idx < GROUP_WIDTH)
+        this->ctrl[this->table_size + idx] = c;
+}
+
+/*
+ * prefetches the first group of tags and the entry at its start
+ */
+static void hashtable_prefetch_home(hashtable_t * this, hashtable_entry_t * entry)
+{
+    unsigned long pos = hashtable_h1(entry->hash) & this->mask;
+
+    hashtable_prefetch(this->ctrl + pos);
+    hashtable_prefetch(hashtable_get_entry(this, pos));
+}
+
+#endif /* HASHTABLE_BACKEND == HASHTABLE_BACKEND_SWISS */
@@ -0,0 +1,822 @@
+#include "lib/hashtable.h"
+
+/* only compiled when this is the backend picked in lib/hashtable.h */
+#if HASHTABLE_BACKEND == HASHTABLE_BACKEND_TREE
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define hashtable_get_entry(ht, idx) ht->table + ((ht->entry_size * (idx)) % (ht->table_size * ht->entry_size))
+#if defined(__GNUC__) || defined(__clang__)
+#define hashtable_prefetch(addr) __builtin_prefetch(addr)
+#else
+#define hashtable_prefetch(addr)
+#endif
+#define hashtable_batch_entry(ht, entries, i) ((hashtable_entry_t *) ((char *) (entries) + (ht)->entry_size * (i)))
+#define hashtable_should_resize(ht) if ((float) ht->size / ht->table_size >= HASHTABLE_LOAD_FACTOR) hashtable_resize(ht);
+
+static unsigned long prime_doubles[] = {
+    1,
+    3,
+    5,
+    11,
+    23,
+    47,
+    97,
+    197,
+    397,
+    797,
+    1597,
+    3203,
+    6421,
+    12853,
+    25717,
+    51437,
+    102877,
+    205759,
+    411527,
+    823117,
+    1646237,
+    3292489,
+    6584983,
+    13169977,
+    26339969,
+    52679969,
+    105359939,
+    210719881,
+    421439783,
+    842879579,
+    1685759167,
+    3371518343,
+    6743036717,
+    13486073473,
+    26972146961,
+    53944293929,
+    107888587883,
+    215777175787,
+    431554351609,
+    863108703229,
+    1726217406467,
+    3452434812973,
+    6904869625999,
+    13809739252051,
+    27619478504183,
+    55238957008387,
+    110477914016779,
+    220955828033581,
+    441911656067171,
+    883823312134381,
+    1767646624268779,
+    3535293248537579
+};
+
+static void * hashtable_probe(hashtable_t *, void * table, unsigned long table_size, hashtable_entry_t * entry,hashtable_lookup_t lu_type);
+static void hashtable_resize(hashtable_t *);
+static void hashtable_resize_to(hashtable_t *, int prime_idx);
+static void hashtable_rehash(hashtable_t *, int prime_idx);
+static void hashtable_migrate(hashtable_t *, unsigned long num);
+static void hashtable_set_empty(hashtable_t *);
+static hashtable_entry_t * hashtable_search(hashtable_t *, hashtable_entry_t * entry);
+static int hashtable_remove(hashtable_t *, void * table, unsigned long table_size, hashtable_entry_t * entry);
+static void hashtable_unlink_node(hashtable_entry_t * bucket, hashtable_entry_t * node);
+static void hashtable_relink(hashtable_t *, hashtable_entry_t * bucket, hashtable_entry_t * node);
+static void hashtable_prefetch_home(hashtable_t *, hashtable_entry_t * entry);
+static void hashtable_copy_entry(hashtable_t *, hashtable_entry_t * dst, hashtable_entry_t * src);
+static hashtable_entry_t * hashtable_node_alloc(hashtable_t *);
+static void hashtable_node_free(hashtable_t *, hashtable_entry_t *);
+static void hashtable_free_slabs(hashtable_slab_t *);
+static unsigned long hashtable_tree_depth(hashtable_entry_t * entry);
+
+static int hashtable_entry_in_table(hashtable_t * this, hashtable_entry_t * entry, void * table, unsigned long table_size)
+{
+    return (table <= (void *) entry && (void *) entry < (table + table_size * this->entry_size));
+}
+
+hashtable_t * hashtable_create(int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
+{
+    hashtable_t * this = malloc(sizeof(hashtable_t));
+    
+    hashtable_init(this, entry_size, entry_cmp, entry_cmp_state, hash_type, hash_seed);
+    
+    return this;
+}
+
+void hashtable_init(hashtable_t * this, int entry_size, int (*entry_cmp)(void *, void *, void *), void * entry_cmp_state, hash_type_t hash_type, hash_seed_t * hash_seed)
+{
+    this->entry_size        = entry_size;
+    this->entry_cmp         = entry_cmp;
+    this->entry_cmp_state   = entry_cmp_state;
+    this->hash_type         = hash_type;
+    
+    /* every table gets its own seed so colliding keys can't be precomputed */
+    if (hash_seed)
+        this->hash_seed = *hash_seed;
+    else
+        hash_seed_random(&this->hash_seed);
+    
+    hashtable_stats_init(this);
+    
+    /* the table is allocated by the first insert */
+    hashtable_set_empty(this);
+}
+
+void * hashtable_lookup_entry(hashtable_t * this, void * entry, hashtable_lookup_t lu_type)
+{
+    unsigned long idx;
+    hashtable_entry_t * ht_entry;
+
+    if (!this->table)
+    {
+        /* nothing to find until the first insert allocates the table */
+        if (lu_type != HASHTABLE_LOOKUP_INSERT)
+            return NULL;
+        
+        this->table = calloc(this->table_size, this->entry_size);
+    }
+
+    /* should we resize? */
+    hashtable_should_resize(this); /* only resizes if it needs to */
+    
+    if (this->old_table)
+        hashtable_migrate(this, HASHTABLE_MIGRATE_STEP);
+    
+    if (lu_type == HASHTABLE_LOOKUP_DELETE)
+    {
+        if (this->old_table && ((hashtable_entry_t *) entry)->hash % this->old_table_size >= this->migrate_idx
+            && hashtable_remove(this, this->old_table, this->old_table_size, entry))
+            return entry;
+        
+        return hashtable_remove(this, this->table, this->table_size, entry) ? entry : NULL;
+    }
+    
+    /* entries whose bucket hasn't been moved yet are still in the old table */
+    if (this->old_table && ((hashtable_entry_t *) entry)->hash % this->old_table_size >= this->migrate_idx)
+    {
+        ht_entry = hashtable_probe(this, this->old_table, this->old_table_size, entry, HASHTABLE_LOOKUP_SEARCH);
+        
+        if (ht_entry && ht_entry->is_occupied)
+            return ht_entry;
+    }
+    
+    ht_entry = hashtable_probe(this, this->table, this->table_size, entry, lu_type);
+
+    /* not found... */
+    if (!ht_entry)
+        return NULL;
+
+    /* no matter what, returned the occupied entry, something was found */
+    if (ht_entry->is_occupied)
+        return ht_entry;
+        
+    /* if we are looking for a node, and didn't find it, return NULL */
+        
+    switch (lu_type)
+    {
+        case HASHTABLE_LOOKUP_INSERT:
+            hashtable_copy_entry(this, ht_entry, entry);
+            ht_entry->is_occupied  = 1;
+            this->size++;
+            break;
+        default:
+            return NULL;
+            break;
+    }
+    
+    return ht_entry;
+}
+
+/*
+ * searches without moving any buckets of a resize in progress, so the
+ * entries found earlier in the batch stay where they are
+ */
+int hashtable_lookup_batch(hashtable_t * this, void * entries, int num, void ** results)
+{
+    int i,
+        found = 0;
+    
+    if (!this->table)
+    {
+        memset(results, 0, num * sizeof(void *));
+        return 0;
+    }
+    
+    for (i = 0; i < num && i < HASHTABLE_PREFETCH_DISTANCE; i++)
+        hashtable_prefetch_home(this, hashtable_batch_entry(this, entries, i));
+    
+    for (i = 0; i < num; i++)
+    {
+        if (i + HASHTABLE_PREFETCH_DISTANCE < num)
+            hashtable_prefetch_home(this, hashtable_batch_entry(this, entries, i + HASHTABLE_PREFETCH_DISTANCE));
+        
+        results[i] = hashtable_search(this, hashtable_batch_entry(this, entries, i));
+        
+        if (results[i])
+            found++;
+    }
+    
+    return found;
+}
+
+void hashtable_reserve(hashtable_t * this, unsigned long count)
+{
+    int prime_idx = this->prime_idx;
+    
+    while ((float) count / prime_doubles[prime_idx] >= HASHTABLE_LOAD_FACTOR)
+        prime_idx++;
+    
+    if (prime_idx != this->prime_idx)
+        hashtable_resize_to(this, prime_idx);
+}
+
+void hashtable_shrink_to_fit(hashtable_t * this)
+{
+    int prime_idx = 0;
+    hashtable_slab_t * slabs = this->slabs;
+    
+    if (this->size == 0)
+    {
+        hashtable_free(this);
+        hashtable_set_empty(this);
+        return;
+    }
+    
+    while ((float) this->size / prime_doubles[prime_idx] >= HASHTABLE_LOAD_FACTOR)
+        prime_idx++;
+    
+    if (prime_idx >= this->prime_idx)
+        return;
+    
+    /* the overflow nodes are moved into new slabs so the old ones can go */
+    this->retired_slabs = slabs;
+    this->slabs         = NULL;
+    this->free_nodes    = NULL;
+    this->slab_bytes    = 0;
+    
+    hashtable_resize_to(this, prime_idx);
+    
+    this->retired_slabs = NULL;
+    hashtable_free_slabs(slabs);
+}
+
+void hashtable_free(hashtable_t * this)
+{
+    free(this->table);
+    free(this->old_table);
+    
+    /* every overflow node lives in a slab, so this frees all of them */
+    hashtable_free_slabs(this->slabs);
+}
+
+void hashtable_destroy(hashtable_t * this)
+{
+    hashtable_free(this);
+    free(this);
+}
+
+unsigned long hashtable_memory_usage(hashtable_t * this)
+{
+    unsigned long bytes = this->slab_bytes;
+    
+    if (this->table)
+        bytes += this->table_size * this->entry_size;
+    
+    if (this->old_table)
+        bytes += this->old_table_size * this->entry_size;
+    
+    return bytes;
+}
+
+void hashtable_stats(hashtable_t * this, hashtable_stats_t * stats)
+{
+    unsigned long i, depth;
+    
+    hashtable_stats_counters(this, stats);
+    
+    stats->size         = this->size;
+    stats->table_size   = this->table_size;
+    stats->load_factor  = (double) this->size / this->table_size;
+    stats->bytes        = hashtable_memory_usage(this);
+    stats->max_chain    = 0;
+    
+    if (!this->table)
+        return;
+    
+    /* a lookup walks down one path of the bucket's tree */
+    for (i = 0; i < this->table_size; i++)
+    {
+        depth = hashtable_tree_depth((hashtable_entry_t *) ((char *) this->table + i * this->entry_size));
+        
+        if (depth > stats->max_chain)
+            stats->max_chain = depth;
+    }
+    
+    for (i = this->migrate_idx; this->old_table && i < this->old_table_size; i++)
+    {
+        depth = hashtable_tree_depth((hashtable_entry_t *) ((char *) this->old_table + i * this->entry_size));
+        
+        if (depth > stats->max_chain)
+            stats->max_chain = depth;
+    }
+}
+
+void * hashtable_next(hashtable_t * this, hashtable_cursor_t * cursor)
+{
+    hashtable_entry_t * entry;
+    unsigned long end;
+    
+    if (cursor->node)
+    {
+        entry = cursor->node;
+        cursor->node = entry->next;
+        return entry;
+    }
+    
+    if (!this->table)
+        return NULL;
+    
+    /* the new table first, then the old buckets that weren't migrated yet */
+    end = this->table_size + (this->old_table ? this->old_table_size : 0);
+    
+    for (; cursor->idx < end; cursor->idx++)
+    {
+        /* old buckets below migrate_idx are already in the new table */
+        if (cursor->idx >= this->table_size && cursor->idx < this->table_size + this->migrate_idx)
+            cursor->idx = this->table_size + this->migrate_idx;
+        
+        if (cursor->idx < this->table_size)
+            entry = (hashtable_entry_t *) ((char *) this->table + cursor->idx * this->entry_size);
+        else
+            entry = (hashtable_entry_t *) ((char *) this->old_table + (cursor->idx - this->table_size) * this->entry_size);
+        
+        if (entry->is_occupied)
+        {
+            cursor->idx++;
+            cursor->node = entry->next;
+            return entry;
+        }
+    }
+    
+    return NULL;
+}
+
+void hashtable_print(hashtable_t * this)
+{
+    unsigned long i, occupied = 0;
+    hashtable_entry_t * entry;
+    const char * fmt = "{\n"
+    "   is_occupied = %d\n"
+    "   hash = %ld\n"
+    "}\n";
+    
+    if (!this->table)
+        return;
+    
+    for (i = 0; i < this->table_size * this->entry_size; i += this->entry_size)
+    {
+        entry = (hashtable_entry_t *) ((char *)this->table + i);
+        
+        if (entry->is_occupied)
+            occupied++;
+        
+        //printf(fmt, entry->is_occupied, entry->hash);
+    }
+    
+    //printf("occupied size = %ld\n", occupied);
+}
+
+/*
+ * Starts moving the entries into a bigger table. With incremental resizing
+ * the old buckets are moved a few at a time by the following lookups.
+ */
+static void hashtable_resize(hashtable_t * this)
+{
+    hashtable_rehash(this, this->prime_idx + 1);
+
+#if !HASHTABLE_INCREMENTAL_RESIZE
+    hashtable_migrate(this, this->old_table_size);
+#endif
+}
+
+/*
+ * moves all the entries into a table of prime_doubles[prime_idx] entries
+ * right away
+ */
+static void hashtable_resize_to(hashtable_t * this, int prime_idx)
+{
+    hashtable_rehash(this, prime_idx);
+    
+    if (this->old_table)
+        hashtable_migrate(this, this->old_table_size);
+}
+
+/*
+ * allocates the table for prime_idx and hands the current one over to be
+ * migrated. Before the first insert only the size is changed.
+ */
+static void hashtable_rehash(hashtable_t * this, int prime_idx)
+{
+    /* a resize that is still in progress has to finish before the next one */
+    if (this->old_table)
+        hashtable_migrate(this, this->old_table_size);
+    
+    this->prime_idx     = prime_idx;
+    
+    if (!this->table)
+    {
+        this->table_size = prime_doubles[prime_idx];
+        return;
+    }
+    
+    hashtable_count_resize(this);
+    hashtable_resize_begin(this);
+    
+    this->old_table         = this->table;
+    this->old_table_size    = this->table_size;
+    this->migrate_idx       = 0;
+    
+    /* TODO - proper error handling */
+    
+    this->table_size = prime_doubles[prime_idx];
+    this->table = calloc(this->table_size, this->entry_size);
+    
+    hashtable_resize_end(this);
+}
+
+/*
+ * re indexes the next num buckets of the old table into the new one, and
+ * frees the old table once all of them are moved
+ */
+static void hashtable_migrate(hashtable_t * this, unsigned long num)
+{
+    hashtable_entry_t * old_entry,
+                      * new_entry,
+                      * tmp;
+
+    hashtable_resize_begin(this);
+    
+    for (; num && this->migrate_idx < this->old_table_size; num--, this->migrate_idx++)
+    {
+        old_entry = (hashtable_entry_t * ) ((char *)this->old_table + this->migrate_idx * this->entry_size);
+        
+        if (old_entry->is_occupied == 0)
+            continue;
+
+        while (old_entry)
+        {
+            new_entry = hashtable_probe(this, this->table, this->table_size, old_entry, HASHTABLE_LOOKUP_INSERT);
+            
+            hashtable_copy_entry(this, new_entry, old_entry);
+            
+            tmp = old_entry;
+            old_entry = old_entry->next;
+            
+            if (!hashtable_entry_in_table(this, tmp, this->old_table, this->old_table_size))
+            {
+                hashtable_node_free(this, tmp);
+            }
+        }
+    }
+    
+    if (this->migrate_idx == this->old_table_size)
+    {
+        free(this->old_table);
+        this->old_table = NULL;
+    }
+    
+    hashtable_resize_end(this);
+}
+
+/*
+ * puts the table back in its initial state, nothing allocated
+ */
+static void hashtable_set_empty(hashtable_t * this)
+{
+    this->size              = 0;
+    this->prime_idx         = 0;
+    this->table_size        = prime_doubles[this->prime_idx];
+    this->table             = NULL;
+    this->old_table         = NULL;
+    this->old_table_size    = 0;
+    this->migrate_idx       = 0;
+    this->slabs             = NULL;
+    this->retired_slabs     = NULL;
+    this->free_nodes        = NULL;
+    this->slab_bytes        = 0;
+}
+
+static void * hashtable_probe(hashtable_t * this, void * table, unsigned long table_size, hashtable_entry_t * entry, hashtable_lookup_t lu_type)
+{
+    int i = 0,
+        cmp_val;
+    unsigned long idx = entry->hash % table_size,
+                  tmp_idx;
+    hashtable_entry_t * ht_entry,
+                      * p,
+                      * prev = NULL,
+                      * new_entry = NULL;
+
+    ht_entry = (hashtable_entry_t *) ((this->entry_size * idx) + (char *) table);
+
+    p = ht_entry;
+
+    while (p)
+    {
+        if (p->is_occupied == 0)
+        {
+            hashtable_count_probe(this, i);
+            return p;
+        }
+     
+        if (p->hash == entry->hash)
+            cmp_val = this->entry_cmp(p, entry, this->entry_cmp_state);
+        else
+            cmp_val = (p->hash < entry->hash) ? -1 : 1;
+        
+        prev = p;
+        i++;
+        
+        if (cmp_val == 0)
+        {
+            hashtable_count_probe(this, i);
+            return p;
+        }
+        else if (cmp_val == 1)
+            p = p->right;
+        else
+            p = p->left;
+    }
+
+    hashtable_count_probe(this, i);
+    
+    // if we've made it this far, then there is no match. return new element
+    if (lu_type != HASHTABLE_LOOKUP_INSERT)
+        return NULL;
+    
+    new_entry = hashtable_node_alloc(this);
+      
+    if (cmp_val == 1)
+        prev->right = new_entry;
+    else
+        prev->left = new_entry;
+    
+    /* every overflow node hangs off the bucket's next list so resize can walk them */
+    new_entry->next = ht_entry->next;
+    ht_entry->next = new_entry;
+    
+    return new_entry;
+}
+
+/*
+ * finds the occupied entry matching entry in either table
+ */
+static hashtable_entry_t * hashtable_search(hashtable_t * this, hashtable_entry_t * entry)
+{
+    hashtable_entry_t * ht_entry;
+    
+    if (this->old_table && entry->hash % this->old_table_size >= this->migrate_idx)
+    {
+        ht_entry = hashtable_probe(this, this->old_table, this->old_table_size, entry, HASHTABLE_LOOKUP_SEARCH);
+        
+        if (ht_entry && ht_entry->is_occupied)
+            return ht_entry;
+    }
+    
+    ht_entry = hashtable_probe(this, this->table, this->table_size, entry, HASHTABLE_LOOKUP_SEARCH);
+    
+    return (ht_entry && ht_entry->is_occupied) ? ht_entry : NULL;
+}
+
+/*
+ * Takes the entry matching entry out of its bucket's tree in table and
+ * copies it into entry. Returns 0 if it isn't there.
+ *
+ * Entries with the same hash are only ordered by entry_cmp being 1 or not,
+ * which isn't a total order, so the removed entry can't be swapped with its
+ * successor. One of its children takes its place instead and the nodes
+ * under the other one are linked back in from the top of the tree.
+ */
+static int hashtable_remove(hashtable_t * this, void * table, unsigned long table_size, hashtable_entry_t * entry)
+{
+    int cmp_val;
+    hashtable_entry_t * bucket = (hashtable_entry_t *) ((char *) table + this->entry_size * (entry->hash % table_size)),
+                      * p = bucket,
+                      ** link = NULL, /* where the parent points at p */
+                      * child,
+                      * other;
+    
+    while (p && p->is_occupied)
+    {
+        if (p->hash == entry->hash)
+            cmp_val = this->entry_cmp(p, entry, this->entry_cmp_state);
+        else
+            cmp_val = (p->hash < entry->hash) ? -1 : 1;
+        
+        if (cmp_val == 0)
+            break;
+        
+        link = (cmp_val == 1) ? &p->right : &p->left;
+        p = *link;
+    }
+    
+    if (!p || !p->is_occupied)
+        return 0;
+    
+    memcpy(entry, p, this->entry_size);
+    
+    child = p->right ? p->right : p->left;
+    other = p->right ? p->left : NULL;
+    
+    if (link)
+        *link = child;
+    else if (child)
+    {
+        /* the bucket itself can't be unlinked, the child's entry moves into it */
+        hashtable_copy_entry(this, bucket, child);
+        bucket->left    = child->left;
+        bucket->right   = child->right;
+        p = child;
+    }
+    else
+    {
+        /* the last entry of the bucket */
+        bucket->is_occupied = 0;
+        this->size--;
+        return 1;
+    }
+    
+    hashtable_unlink_node(bucket, p);
+    hashtable_node_free(this, p);
+    
+    if (other)
+        hashtable_relink(this, bucket, other);
+    
+    this->size--;
+    
+    return 1;
+}
+
+/*
+ * takes the overflow node off the bucket's next list
+ */
+static void hashtable_unlink_node(hashtable_entry_t * bucket, hashtable_entry_t * node)
+{
+    hashtable_entry_t ** link = &bucket->next;
+    
+    while (*link != node)
+        link = &(*link)->next;
+    
+    *link = node->next;
+}
+
+/*
+ * links node and the nodes under it back into the bucket's tree, each as a
+ * new leaf the way an insert would place it
+ */
+static void hashtable_relink(hashtable_t * this, hashtable_entry_t * bucket, hashtable_entry_t * node)
+{
+    hashtable_entry_t * left = node->left,
+                      * right = node->right,
+                      * p = bucket,
+                      ** link;
+    int cmp_val;
+    
+    node->left  = NULL;
+    node->right = NULL;
+    
+    while (1)
+    {
+        if (p->hash == node->hash)
+            cmp_val = this->entry_cmp(p, node, this->entry_cmp_state);
+        else
+            cmp_val = (p->hash < node->hash) ? -1 : 1;
+        
+        link = (cmp_val == 1) ? &p->right : &p->left;
+        
+        if (!*link)
+            break;
+        
+        p = *link;
+    }
+    
+    *link = node;
+    
+    if (left)
+        hashtable_relink(this, bucket, left);
+    
+    if (right)
+        hashtable_relink(this, bucket, right);
+}
+
+static void hashtable_prefetch_home(hashtable_t * this, hashtable_entry_t * entry)
+{
+    if (this->old_table && entry->hash % this->old_table_size >= this->migrate_idx)
+        hashtable_prefetch((char *) this->old_table + this->entry_size * (entry->hash % this->old_table_size));
+    
+    hashtable_prefetch((char *) this->table + this->entry_size * (entry->hash % this->table_size));
+}
+
+/*
+ * copies the entry data into dst but keeps the tree and list links dst
+ * already has in the table
+ */
+static void hashtable_copy_entry(hashtable_t * this, hashtable_entry_t * dst, hashtable_entry_t * src)
+{
+    hashtable_entry_t * left = dst->left,
+                      * right = dst->right,
+                      * next = dst->next;
+    
+    memcpy(dst, src, this->entry_size);
+    
+    dst->left   = left;
+    dst->right  = right;
+    dst->next   = next;
+}
+
+/*
+ * hands out a cleared overflow node, reusing freed nodes before taking a
+ * new one from the current slab
+ */
+static hashtable_entry_t * hashtable_node_alloc(hashtable_t * this)
+{
+    hashtable_entry_t * node;
+    hashtable_slab_t * slab = this->slabs;
+    unsigned long num_nodes;
+    
+    if (this->free_nodes)
+    {
+        node = this->free_nodes;
+        this->free_nodes = node->next;
+    }
+    else
+    {
+        if (!slab || slab->used == slab->num_nodes)
+        {
+            num_nodes = slab ? slab->num_nodes * 2 : HASHTABLE_SLAB_MIN_NODES;
+            
+            if (num_nodes > HASHTABLE_SLAB_MAX_NODES)
+                num_nodes = HASHTABLE_SLAB_MAX_NODES;
+            
+            /* TODO - proper error handling */
+            slab = malloc(sizeof(hashtable_slab_t) + num_nodes * this->entry_size);
+            slab->next      = this->slabs;
+            slab->num_nodes = num_nodes;
+            slab->used      = 0;
+            
+            this->slabs = slab;
+            this->slab_bytes += sizeof(hashtable_slab_t) + num_nodes * this->entry_size;
+        }
+        
+        node = (hashtable_entry_t *) ((char *) (slab + 1) + slab->used * this->entry_size);
+        slab->used++;
+    }
+    
+    memset(node, 0, this->entry_size);
+    
+    return node;
+}
+
+/*
+ * puts an overflow node on the free list, the memory goes back with the slabs
+ * in hashtable_free
+ */
+static void hashtable_node_free(hashtable_t * this, hashtable_entry_t * node)
+{
+    /* while shrinking, the old nodes are freed with their slabs instead of being reused */
+    if (this->retired_slabs)
+        return;
+    
+    node->next = this->free_nodes;
+    this->free_nodes = node;
+}
+
+static void hashtable_free_slabs(hashtable_slab_t * slab)
+{
+    hashtable_slab_t * tmp;
+    
+    while (slab)
+    {
+        tmp = slab;
+        slab = slab->next;
+        free(tmp);
+    }
+}
+
+/*
+ * number of entries on the longest path down the bucket's tree
+ */
+static unsigned long hashtable_tree_depth(hashtable_entry_t * entry)
+{
+    unsigned long left, right;
+    
+    if (!entry || !entry->is_occupied)
+        return 0;
+    
+    left = hashtable_tree_depth(entry->left);
+    right = hashtable_tree_depth(entry->right);
+    
+    return 1 + (left > right ? left : right);
+}
+
+#endif /* HASHTABLE_BACKEND == HASHTABLE_BACKEND_TREE */
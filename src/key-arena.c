@@ -0,0 +1,101 @@
+#include "lib/key-arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* bytes a key of len takes, prefix and '\0' included, kept aligned for the next prefix */
+#define key_arena_record_size(len) ((sizeof(uint32_t) + (len) + 1 + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1))
+
+static key_arena_block_t * key_arena_add_block(key_arena_t *, unsigned long min_size);
+
+void key_arena_init(key_arena_t * this)
+{
+    this->blocks    = NULL;
+    this->used      = 0;
+    this->dead      = 0;
+    this->allocated = 0;
+}
+
+char * key_arena_push(key_arena_t * this, const char * str, int len)
+{
+    unsigned long size = key_arena_record_size(len);
+    key_arena_block_t * block = this->blocks;
+    char * record;
+
+    if (!block || block->used + size > block->size)
+        block = key_arena_add_block(this, size);
+
+    if (block == NULL)
+        return NULL;
+
+    record = (char *) (block + 1) + block->used;
+    block->used += size;
+    this->used  += size;
+
+    *(uint32_t *) record = len;
+    memcpy(record + sizeof(uint32_t), str, len);
+    record[sizeof(uint32_t) + len] = '\0';
+
+    return record + sizeof(uint32_t);
+}
+
+void key_arena_release(key_arena_t * this, char * key)
+{
+    this->dead += key_arena_record_size(key_arena_len(key));
+}
+
+int key_arena_reserve(key_arena_t * this, unsigned long bytes)
+{
+    key_arena_block_t * block = this->blocks;
+
+    if (bytes == 0 || (block && block->used + bytes <= block->size))
+        return 1;
+
+    return key_arena_add_block(this, bytes) != NULL;
+}
+
+void key_arena_free(key_arena_t * this)
+{
+    key_arena_block_t * block = this->blocks,
+                      * tmp;
+
+    while (block)
+    {
+        tmp = block;
+        block = block->next;
+        free(tmp);
+    }
+
+    key_arena_init(this);
+}
+
+/*
+ * starts a new block of at least min_size bytes, twice the size of the one
+ * before up to KEY_ARENA_MAX_BLOCK. What is left of the old block stays
+ * unused. NULL when out of memory, the arena is unchanged then.
+ */
+static key_arena_block_t * key_arena_add_block(key_arena_t * this, unsigned long min_size)
+{
+    key_arena_block_t * block;
+    unsigned long size = this->blocks ? this->blocks->size * 2 : KEY_ARENA_MIN_BLOCK;
+
+    if (size > KEY_ARENA_MAX_BLOCK)
+        size = KEY_ARENA_MAX_BLOCK;
+
+    if (size < min_size)
+        size = min_size;
+
+    block = malloc(sizeof(key_arena_block_t) + size);
+
+    if (block == NULL)
+        return NULL;
+
+    block->next = this->blocks;
+    block->size = size;
+    block->used = 0;
+
+    this->blocks = block;
+    this->allocated += sizeof(key_arena_block_t) + size;
+
+    return block;
+}
@@ -0,0 +1,154 @@
+#include "lib/umap-concurrent.h"
+#include "lib/umap/common.h"
+
+#include <stdlib.h>
+
+/*
+ * picks the shard from the high half of the hash, the tables index with
+ * the low bits
+ */
+#define umap_concurrent_shard(m, hash) (&(m)->shards[((hash) >> (sizeof(unsigned long) * 4)) % (m)->num_shards])
+
+static int umap_concurrent_entry_eql(void * e1, void * e2, void *);
+
+umap_concurrent_t * umap_concurrent_create(int num_shards)
+{
+    umap_concurrent_t * this = (umap_concurrent_t *) malloc(sizeof(umap_concurrent_t));
+    
+    if (this && !umap_concurrent_init(this, num_shards))
+    {
+        free(this);
+        return NULL;
+    }
+    
+    return this;
+}
+
+int umap_concurrent_init(umap_concurrent_t * this, int num_shards)
+{
+    int i;
+    
+    this->num_shards    = num_shards > 0 ? num_shards : UMAP_CONCURRENT_SHARDS;
+    this->key_type      = UMAP_KEY_TYPE_STRING;
+    this->val_type      = UMAP_VAL_TYPE_DATA;
+    this->hash_type     = HASH_TYPE_MURMUR;
+    
+    hash_seed_random(&this->hash_seed);
+    
+    this->shards = malloc(this->num_shards * sizeof(umap_shard_t));
+    
+    if (this->shards == NULL)
+        return 0;
+    
+    for (i = 0; i < this->num_shards; i++)
+    {
+        hashtable_init(&this->shards[i].ht, sizeof(umap_entry_t), umap_concurrent_entry_eql, this, this->hash_type, &this->hash_seed);
+        pthread_mutex_init(&this->shards[i].lock, NULL);
+    }
+    
+    return 1;
+}
+
+void umap_concurrent_add(umap_concurrent_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_entry_t mi;
+    umap_shard_t * shard;
+
+    /* grab the key and value*/
+    va_start(ap, this);
+
+    mi.key = umap_get_va_key(this->key_type, ap);
+    mi.value = umap_get_va_val(this->val_type, ap);
+    
+    va_end(ap);
+    
+    /* the key is hashed before taking the lock */
+    mi.is_occupied = 0;
+    umap_hash_entry_key(this->key_type, this->hash_type, &this->hash_seed, &mi);
+    
+    shard = umap_concurrent_shard(this, mi.hash);
+    
+    pthread_mutex_lock(&shard->lock);
+    hashtable_lookup_entry(&shard->ht, &mi, HASHTABLE_LOOKUP_INSERT);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+int umap_concurrent_get(umap_concurrent_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_datum_t * ret;
+    umap_entry_t mi,
+                 * ht_entry;
+    umap_shard_t * shard;
+    int found = 0;
+    
+    /* grab the key and data return pointer */
+    va_start(ap, this);
+    
+    mi.key = umap_get_va_key(this->key_type, ap);
+    ret = va_arg(ap, umap_datum_t *);
+    
+    va_end(ap);
+    
+    mi.is_occupied = 0;
+    umap_hash_entry_key(this->key_type, this->hash_type, &this->hash_seed, &mi);
+    
+    shard = umap_concurrent_shard(this, mi.hash);
+    
+    /* lookups can resize or migrate the table too, so they need the lock as well */
+    pthread_mutex_lock(&shard->lock);
+    
+    ht_entry = hashtable_lookup_entry(&shard->ht, &mi, HASHTABLE_LOOKUP_SEARCH);
+    
+    if (ht_entry)
+    {
+        found = 1;
+        
+        if (ret)
+            umap_copy_val(this->val_type, ret, ht_entry->value);
+    }
+    
+    pthread_mutex_unlock(&shard->lock);
+    
+    return found;
+}
+
+unsigned long umap_concurrent_size(umap_concurrent_t * this)
+{
+    unsigned long size = 0;
+    int i;
+    
+    for (i = 0; i < this->num_shards; i++)
+    {
+        pthread_mutex_lock(&this->shards[i].lock);
+        size += this->shards[i].ht.size;
+        pthread_mutex_unlock(&this->shards[i].lock);
+    }
+    
+    return size;
+}
+
+void umap_concurrent_free(umap_concurrent_t * this)
+{
+    int i;
+    
+    for (i = 0; i < this->num_shards; i++)
+    {
+        hashtable_free(&this->shards[i].ht);
+        pthread_mutex_destroy(&this->shards[i].lock);
+    }
+    
+    free(this->shards);
+}
+
+void umap_concurrent_destroy(umap_concurrent_t * this)
+{
+    umap_concurrent_free(this);
+    free(this);
+}
+
+static int umap_concurrent_entry_eql(void * e1, void * e2, void * this)
+{
+    return umap_key_cmp(((umap_concurrent_t *) this)->key_type, e1, e2);
+}
@@ -0,0 +1,297 @@
+#include "lib/umap-frozen.h"
+#include "lib/umap/common.h"
+
+#include <stdlib.h>
+
+/* the largest displacement a bucket can have */
+#define UMAP_FROZEN_MAX_DISP 0xffff
+
+/* maps the low 32 bits of x onto 0 .. n - 1 without a division */
+#define umap_frozen_range(x, n)         ((unsigned long) (((uint64_t) (uint32_t) (x) * (n)) >> 32))
+#define umap_frozen_bucket(m, hash)     umap_frozen_range(hash_int((hash) ^ (m)->salt), (m)->num_buckets)
+#define umap_frozen_slot(m, hash, d)    umap_frozen_range(hash_int((hash) + (m)->salt + ((uint64_t) (d) + 1) * 0x9e3779b97f4a7c15ULL), (m)->num_slots)
+
+static int umap_frozen_place(umap_frozen_t *, umap_frozen_entry_t * keys);
+static void umap_frozen_free_arrays(umap_frozen_t *);
+
+umap_frozen_t * umap_freeze(umap_t * map)
+{
+    umap_frozen_t * this = malloc(sizeof(umap_frozen_t));
+    umap_frozen_entry_t * keys;
+    umap_entry_t * entry;
+    hashtable_cursor_t cursor;
+    unsigned long i = 0;
+    int salt_idx,
+        placed = 0,
+        copy_keys = map->own_keys && map->key_type == UMAP_KEY_TYPE_STRING;
+
+    if (this == NULL)
+        return NULL;
+
+    this->size          = map->ht.size;
+    this->key_type      = map->key_type;
+    this->val_type      = map->val_type;
+    this->hash_type     = map->ht.hash_type;
+    this->hash_seed     = map->ht.hash_seed;
+    this->num_buckets   = this->size / UMAP_FROZEN_BUCKET_SIZE + 1;
+    this->num_slots     = (unsigned long) (this->size / UMAP_FROZEN_LOAD_FACTOR) + 1;
+
+    key_arena_init(&this->keys);
+
+    keys = malloc((this->size + 1) * sizeof(umap_frozen_entry_t));
+
+    /* the copies go in one block, so the pushes below can't fail */
+    if (keys == NULL || (copy_keys && !key_arena_reserve(&this->keys, key_arena_live(&map->keys))))
+    {
+        free(keys);
+        free(this);
+        return NULL;
+    }
+
+    hashtable_cursor_init(&cursor);
+
+    while ((entry = hashtable_next(&map->ht, &cursor)))
+    {
+        keys[i].hash    = entry->hash;
+        keys[i].key_len = entry->key_len;
+        keys[i].key     = entry->key;
+        keys[i].value   = entry->value;
+
+        if (copy_keys)
+            keys[i].key.p = key_arena_push(&this->keys, entry->key.p, entry->key_len);
+
+        i++;
+    }
+
+    /* a new salt reshuffles everything, it's rarely needed more than once */
+    for (salt_idx = 0; salt_idx < UMAP_FROZEN_MAX_SALTS && placed == 0; salt_idx++)
+    {
+        this->salt = hash_int(salt_idx + 1);
+        placed = umap_frozen_place(this, keys);
+    }
+
+    free(keys);
+
+    if (placed == 1)
+        return this;
+
+    key_arena_free(&this->keys);
+    free(this);
+
+    return NULL;
+}
+
+int umap_frozen_get(umap_frozen_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_datum_t * ret;
+    umap_entry_t mi,
+                 ht_entry;
+    umap_frozen_entry_t * entry;
+    unsigned long slot;
+
+    /* grab the key and data return pointer */
+    va_start(ap, this);
+
+    mi.key = umap_get_va_key(this->key_type, ap);
+    ret = va_arg(ap, umap_datum_t *);
+
+    va_end(ap);
+
+    if (this->size == 0)
+        return 0;
+
+    umap_hash_entry_key(this->key_type, this->hash_type, &this->hash_seed, &mi);
+
+    slot = umap_frozen_slot(this, mi.hash, this->disp[umap_frozen_bucket(this, mi.hash)]);
+
+    if (slot >= this->size)
+        slot = this->remap[slot - this->size];
+
+    /* the key can't be anywhere else */
+    entry = &this->entries[slot];
+
+    if (entry->hash != mi.hash)
+        return 0;
+
+    ht_entry.key        = entry->key;
+    ht_entry.key_len    = entry->key_len;
+
+    if (umap_key_cmp(this->key_type, &ht_entry, &mi) != 0)
+        return 0;
+
+    if (ret)
+        umap_copy_val(this->val_type, ret, entry->value);
+
+    return 1;
+}
+
+unsigned long umap_frozen_memory_usage(umap_frozen_t * this)
+{
+    return this->size * sizeof(umap_frozen_entry_t)
+        + this->num_buckets * sizeof(uint16_t)
+        + (this->num_slots - this->size) * sizeof(uint32_t)
+        + this->keys.allocated;
+}
+
+double umap_frozen_bits_per_key(umap_frozen_t * this)
+{
+    if (this->size == 0)
+        return 0;
+
+    return 8.0 * (this->num_buckets * sizeof(uint16_t) + (this->num_slots - this->size) * sizeof(uint32_t)) / this->size;
+}
+
+void umap_frozen_destroy(umap_frozen_t * this)
+{
+    umap_frozen_free_arrays(this);
+    key_arena_free(&this->keys);
+    free(this);
+}
+
+/*
+ * Searches the displacements for the current salt. The buckets are placed
+ * biggest first, while there are still lots of free slots, and each takes
+ * the first displacement that sends all its keys to free slots. Returns 0
+ * if some bucket had none and -1 when out of memory.
+ */
+static int umap_frozen_place(umap_frozen_t * this, umap_frozen_entry_t * keys)
+{
+    unsigned long * bucket_start = calloc(this->num_buckets + 1, sizeof(unsigned long)),
+                  * members = malloc((this->size + 1) * sizeof(unsigned long)),
+                  * key_slot = malloc((this->size + 1) * sizeof(unsigned long)),
+                  * order = malloc(this->num_buckets * sizeof(unsigned long)),
+                  * size_start = calloc(this->size + 2, sizeof(unsigned long)), /* no bucket has more than every key */
+                  max_bucket = 0,
+                  i,
+                  j,
+                  b,
+                  n,
+                  hole = 0;
+    unsigned char * taken = calloc(this->num_slots, 1);
+    unsigned int d;
+    int ok = 1;
+
+    this->disp      = calloc(this->num_buckets, sizeof(uint16_t));
+    this->entries   = malloc((this->size + 1) * sizeof(umap_frozen_entry_t));
+    this->remap     = calloc(this->num_slots - this->size, sizeof(uint32_t)); /* unused slots point at any entry */
+
+    if (!bucket_start || !members || !key_slot || !order || !size_start || !taken || !this->disp || !this->entries || !this->remap)
+    {
+        free(bucket_start);
+        free(members);
+        free(key_slot);
+        free(order);
+        free(size_start);
+        free(taken);
+        umap_frozen_free_arrays(this);
+
+        return -1;
+    }
+
+    /* group the keys by bucket */
+    for (i = 0; i < this->size; i++)
+        bucket_start[umap_frozen_bucket(this, keys[i].hash) + 1]++;
+
+    for (b = 0; b < this->num_buckets; b++)
+    {
+        if (bucket_start[b + 1] > max_bucket)
+            max_bucket = bucket_start[b + 1];
+
+        bucket_start[b + 1] += bucket_start[b];
+    }
+
+    for (i = 0; i < this->size; i++)
+        members[bucket_start[umap_frozen_bucket(this, keys[i].hash)]++] = i;
+
+    /* the fill above moved every start to the next bucket's */
+    for (b = this->num_buckets; b > 0; b--)
+        bucket_start[b] = bucket_start[b - 1];
+
+    bucket_start[0] = 0;
+
+    /* counting sort of the buckets, biggest first */
+    for (b = 0; b < this->num_buckets; b++)
+        size_start[max_bucket - (bucket_start[b + 1] - bucket_start[b]) + 1]++;
+
+    for (i = 0; i <= max_bucket; i++)
+        size_start[i + 1] += size_start[i];
+
+    for (b = 0; b < this->num_buckets; b++)
+        order[size_start[max_bucket - (bucket_start[b + 1] - bucket_start[b])]++] = b;
+
+    for (i = 0; i < this->num_buckets && ok; i++)
+    {
+        b = order[i];
+        n = bucket_start[b + 1] - bucket_start[b];
+
+        /* the rest are empty buckets */
+        if (n == 0)
+            break;
+
+        for (d = 0; d <= UMAP_FROZEN_MAX_DISP; d++)
+        {
+            for (j = 0; j < n; j++)
+            {
+                key_slot[j] = umap_frozen_slot(this, keys[members[bucket_start[b] + j]].hash, d);
+
+                if (taken[key_slot[j]])
+                    break;
+
+                /* taken right away so two keys of the bucket can't share a slot */
+                taken[key_slot[j]] = 1;
+            }
+
+            if (j == n)
+                break;
+
+            while (j--)
+                taken[key_slot[j]] = 0;
+        }
+
+        if (d > UMAP_FROZEN_MAX_DISP)
+        {
+            ok = 0;
+            break;
+        }
+
+        this->disp[b] = d;
+    }
+
+    /* the keys past the end fill the holes the others left */
+    for (i = 0; i < this->size && ok; i++)
+    {
+        j = umap_frozen_slot(this, keys[i].hash, this->disp[umap_frozen_bucket(this, keys[i].hash)]);
+
+        if (j >= this->size)
+        {
+            while (taken[hole])
+                hole++;
+
+            taken[hole] = 1;
+            this->remap[j - this->size] = hole;
+            j = hole;
+        }
+
+        this->entries[j] = keys[i];
+    }
+
+    free(bucket_start);
+    free(members);
+    free(key_slot);
+    free(order);
+    free(size_start);
+    free(taken);
+
+    if (!ok)
+        umap_frozen_free_arrays(this);
+
+    return ok;
+}
+
+static void umap_frozen_free_arrays(umap_frozen_t * this)
+{
+    free(this->entries);
+    free(this->disp);
+    free(this->remap);
+}
@@ -0,0 +1,347 @@
+#include "lib/umap-mmap.h"
+#include "lib/umap/common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* the slot array starts on a cache line */
+#define UMAP_FILE_ALIGN 64
+
+static uint64_t umap_file_pack(int is_double, umap_datum_t);
+static umap_datum_t umap_file_unpack(int is_double, uint64_t bits);
+static int umap_file_write(const char * path, umap_file_header_t *, umap_file_slot_t *, char * blob);
+static int umap_file_check(const umap_file_header_t *, size_t len);
+static int umap_mmap_slot_key(umap_mmap_t *, const umap_file_slot_t *, umap_entry_t *);
+
+int umap_save(umap_t * this, const char * path)
+{
+    umap_file_header_t header;
+    umap_file_slot_t * slots,
+                     * slot;
+    umap_entry_t * entry;
+    hashtable_cursor_t cursor;
+    char * blob;
+    uint64_t blob_size = 0,
+             mask,
+             idx;
+    int ret;
+
+    if (this->val_type == UMAP_VAL_TYPE_DATA)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, UMAP_FILE_MAGIC, sizeof(header.magic));
+
+    header.version      = UMAP_FILE_VERSION;
+    header.byte_order   = UMAP_FILE_BYTE_ORDER;
+    header.hash_bits    = sizeof(unsigned long) * 8;
+    header.key_type     = this->key_type;
+    header.val_type     = this->val_type;
+    header.hash_type    = this->ht.hash_type;
+    header.hash_k0      = this->ht.hash_seed.k0;
+    header.hash_k1      = this->ht.hash_seed.k1;
+    header.size         = this->ht.size;
+
+    /* there is always an empty slot, which ends every probe */
+    for (header.num_slots = 8; header.num_slots * UMAP_FILE_LOAD_FACTOR < header.size + 1; header.num_slots *= 2)
+        ;
+
+    mask = header.num_slots - 1;
+
+    if (this->key_type == UMAP_KEY_TYPE_STRING)
+    {
+        hashtable_cursor_init(&cursor);
+
+        while ((entry = hashtable_next(&this->ht, &cursor)))
+            blob_size += entry->key_len + 1;
+    }
+
+    header.blob_size    = blob_size;
+    header.slots_off    = (sizeof(header) + UMAP_FILE_ALIGN - 1) / UMAP_FILE_ALIGN * UMAP_FILE_ALIGN;
+    header.blob_off     = header.slots_off + header.num_slots * sizeof(umap_file_slot_t);
+    header.file_size    = header.blob_off + blob_size;
+
+    slots   = calloc(header.num_slots, sizeof(umap_file_slot_t));
+    blob    = malloc(blob_size ? blob_size : 1);
+
+    if (!slots || !blob)
+    {
+        free(slots);
+        free(blob);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    blob_size = 0;
+    hashtable_cursor_init(&cursor);
+
+    /* the same linear probing umap_mmap_get reads them back with */
+    while ((entry = hashtable_next(&this->ht, &cursor)))
+    {
+        for (idx = entry->hash & mask; slots[idx].is_occupied; idx = (idx + 1) & mask)
+            ;
+
+        slot = &slots[idx];
+        slot->hash          = entry->hash;
+        slot->value         = umap_file_pack(this->val_type == UMAP_VAL_TYPE_DOUBLE, entry->value);
+        slot->is_occupied   = 1;
+
+        if (this->key_type == UMAP_KEY_TYPE_STRING)
+        {
+            slot->key       = blob_size;
+            slot->key_len   = entry->key_len;
+
+            memcpy(blob + blob_size, entry->key.p, entry->key_len);
+            blob[blob_size + entry->key_len] = '\0';
+            blob_size += entry->key_len + 1;
+        }
+        else
+        {
+            slot->key       = umap_file_pack(this->key_type == UMAP_KEY_TYPE_DOUBLE, entry->key);
+            slot->key_len   = entry->key_len;
+        }
+    }
+
+    ret = umap_file_write(path, &header, slots, blob);
+
+    free(slots);
+    free(blob);
+
+    return ret;
+}
+
+umap_mmap_t * umap_open_mmap(const char * path)
+{
+    umap_mmap_t * this;
+    struct stat st;
+    void * base;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return NULL;
+
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    if ((size_t) st.st_size < sizeof(umap_file_header_t))
+    {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED)
+        return NULL;
+
+    if (!umap_file_check(base, st.st_size) || !(this = malloc(sizeof(umap_mmap_t))))
+    {
+        munmap(base, st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    this->base      = base;
+    this->len       = st.st_size;
+    this->header    = base;
+    this->slots     = (const umap_file_slot_t *) ((const char *) base + this->header->slots_off);
+    this->blob      = (const char *) base + this->header->blob_off;
+    this->mask      = this->header->num_slots - 1;
+
+    this->hash_seed.k0 = this->header->hash_k0;
+    this->hash_seed.k1 = this->header->hash_k1;
+
+    return this;
+}
+
+int umap_mmap_get(umap_mmap_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_datum_t * ret;
+    umap_entry_t mi,
+                 slot_entry;
+    umap_key_type_t key_type = this->header->key_type;
+    const umap_file_slot_t * slot;
+    uint64_t idx,
+             steps;
+
+    /* grab the key and data return pointer */
+    va_start(ap, this);
+
+    mi.key = umap_get_va_key(key_type, ap);
+    ret = va_arg(ap, umap_datum_t *);
+
+    va_end(ap);
+
+    umap_hash_entry_key(key_type, this->header->hash_type, &this->hash_seed, &mi);
+
+    /*
+     * a saved file always has an empty slot, the header's size can't prove
+     * that for a corrupt one, so no probe goes round the table twice
+     */
+    for (idx = mi.hash & this->mask, steps = 0;
+         steps <= this->mask && (slot = &this->slots[idx])->is_occupied;
+         idx = (idx + 1) & this->mask, steps++)
+    {
+        if (slot->hash != (uint64_t) mi.hash || !umap_mmap_slot_key(this, slot, &slot_entry))
+            continue;
+
+        if (umap_key_cmp(key_type, &slot_entry, &mi) == 0)
+        {
+            if (ret)
+                umap_copy_val(this->header->val_type, ret, umap_file_unpack(this->header->val_type == UMAP_VAL_TYPE_DOUBLE, slot->value));
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void umap_mmap_close(umap_mmap_t * this)
+{
+    munmap(this->base, this->len);
+    free(this);
+}
+
+/*
+ * the bits of an int or double datum, ints zero extended
+ */
+static uint64_t umap_file_pack(int is_double, umap_datum_t datum)
+{
+    uint64_t bits;
+
+    if (is_double)
+        memcpy(&bits, &datum.d, sizeof(bits));
+    else
+        bits = (uint32_t) datum.i;
+
+    return bits;
+}
+
+static umap_datum_t umap_file_unpack(int is_double, uint64_t bits)
+{
+    umap_datum_t datum;
+
+    if (is_double)
+        memcpy(&datum.d, &bits, sizeof(bits));
+    else
+        datum.i = (int) (uint32_t) bits;
+
+    return datum;
+}
+
+/*
+ * writes the image to a temporary file next to path and renames it over
+ * path, so path never holds half an image
+ */
+static int umap_file_write(const char * path, umap_file_header_t * header, umap_file_slot_t * slots, char * blob)
+{
+    static const char padding[UMAP_FILE_ALIGN];
+    char * tmp_path = malloc(strlen(path) + 5);
+    FILE * fp;
+    int ok;
+
+    if (!tmp_path)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    sprintf(tmp_path, "%s.tmp", path);
+
+    if (!(fp = fopen(tmp_path, "wb")))
+    {
+        free(tmp_path);
+        return -1;
+    }
+
+    ok = fwrite(header, sizeof(*header), 1, fp) == 1
+        && fwrite(padding, 1, header->slots_off - sizeof(*header), fp) == header->slots_off - sizeof(*header)
+        && fwrite(slots, sizeof(umap_file_slot_t), header->num_slots, fp) == header->num_slots
+        && fwrite(blob, 1, header->blob_size, fp) == header->blob_size;
+
+    ok = (fclose(fp) == 0) && ok;
+
+    if (!ok || rename(tmp_path, path) < 0)
+    {
+        unlink(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    free(tmp_path);
+
+    return 0;
+}
+
+/*
+ * checks that the header is one this build can read and that everything it
+ * points to is inside the file
+ */
+static int umap_file_check(const umap_file_header_t * header, size_t len)
+{
+    uint64_t slots_end;
+
+    if (memcmp(header->magic, UMAP_FILE_MAGIC, sizeof(header->magic)) != 0
+        || header->version != UMAP_FILE_VERSION
+        || header->byte_order != UMAP_FILE_BYTE_ORDER
+        || header->hash_bits != sizeof(unsigned long) * 8)
+        return 0;
+
+    if (header->key_type > UMAP_KEY_TYPE_STRING
+        || header->val_type >= UMAP_VAL_TYPE_DATA
+        || header->hash_type > HASH_TYPE_SIPHASH)
+        return 0;
+
+    if (header->file_size != len
+        || header->num_slots == 0
+        || (header->num_slots & (header->num_slots - 1)) != 0
+        || header->size >= header->num_slots
+        || header->num_slots > len / sizeof(umap_file_slot_t))
+        return 0;
+
+    slots_end = header->slots_off + header->num_slots * sizeof(umap_file_slot_t);
+
+    return header->slots_off >= sizeof(umap_file_header_t)
+        && header->slots_off % UMAP_FILE_ALIGN == 0
+        && slots_end <= header->blob_off
+        && header->blob_off <= len
+        && header->blob_size <= len - header->blob_off;
+}
+
+/*
+ * fills in the key of the slot as a umap entry, returns 0 for a string key
+ * that doesn't lie inside the blob
+ */
+static int umap_mmap_slot_key(umap_mmap_t * this, const umap_file_slot_t * slot, umap_entry_t * entry)
+{
+    entry->key_len = slot->key_len;
+
+    if (this->header->key_type != UMAP_KEY_TYPE_STRING)
+    {
+        entry->key = umap_file_unpack(this->header->key_type == UMAP_KEY_TYPE_DOUBLE, slot->key);
+        return 1;
+    }
+
+    if (slot->key >= this->header->blob_size || slot->key_len >= this->header->blob_size - slot->key)
+        return 0;
+
+    entry->key.p = (void *) (this->blob + slot->key);
+
+    return 1;
+}
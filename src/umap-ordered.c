@@ -0,0 +1,342 @@
+#include "lib/umap-ordered.h"
+#include "lib/umap/common.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* the entry a nonzero slot of the index holds */
+#define umap_ordered_entry(m, slot)     ((umap_entry_t *) vector_get(&(m)->entries, (slot) - 1))
+#define umap_ordered_home(m, hash)      ((hash) & ((m)->num_slots - 1))
+#define umap_ordered_next_slot(m, i)    (((i) + 1) & ((m)->num_slots - 1))
+
+static uint32_t * umap_ordered_probe(umap_ordered_t *, umap_entry_t *);
+static void umap_ordered_unlink(umap_ordered_t *, unsigned long);
+static int umap_ordered_rebuild_index(umap_ordered_t *, unsigned long num_slots);
+static unsigned long umap_ordered_slots_for(unsigned long count);
+static void umap_ordered_va_lookup(umap_ordered_t *, umap_entry_t *, va_list);
+
+umap_ordered_t * umap_ordered_create()
+{
+    umap_ordered_t * this = (umap_ordered_t *) malloc(sizeof(umap_ordered_t));
+
+    umap_ordered_init(this);
+
+    return this;
+}
+
+void umap_ordered_init(umap_ordered_t * this)
+{
+    vector_init(&this->entries, sizeof(umap_entry_t));
+    hash_seed_random(&this->hash_seed);
+
+    this->index     = NULL;
+    this->num_slots = 0;
+    this->size      = 0;
+    this->key_type  = UMAP_KEY_TYPE_STRING;
+    this->val_type  = UMAP_VAL_TYPE_DATA;
+    this->hash_type = HASH_TYPE_MURMUR;
+}
+
+void umap_ordered_add(umap_ordered_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_entry_t mi;
+    uint32_t * slot;
+
+    /* grab the key and value*/
+    va_start(ap, this);
+
+    mi.key = umap_get_va_key(this->key_type, ap);
+    mi.value = umap_get_va_val(this->val_type, ap);
+
+    va_end(ap);
+
+    mi.is_occupied = 1;
+    umap_hash_entry_key(this->key_type, this->hash_type, &this->hash_seed, &mi);
+
+    slot = umap_ordered_probe(this, &mi);
+
+    if (slot && *slot)
+    {
+        umap_ordered_entry(this, *slot)->value = mi.value;
+        return;
+    }
+
+    /* a new key, growing the index moves the slot it goes in */
+    if (this->size + 1 > this->num_slots * UMAP_ORDERED_LOAD_FACTOR)
+    {
+        umap_ordered_rebuild_index(this, umap_ordered_slots_for(this->size + 1));
+        slot = umap_ordered_probe(this, &mi);
+    }
+
+    /* no memory for a bigger index and no free slot left in the old one */
+    if (slot == NULL || this->size + 1 >= this->num_slots)
+        return;
+
+    *(umap_entry_t *) vector_push(&this->entries) = mi;
+    *slot = vector_count(&this->entries);
+    this->size++;
+}
+
+int umap_ordered_get(umap_ordered_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_datum_t * ret;
+    umap_entry_t mi;
+    uint32_t * slot;
+
+    /* grab the key and data return pointer */
+    va_start(ap, this);
+
+    umap_ordered_va_lookup(this, &mi, ap);
+    ret = va_arg(ap, umap_datum_t *);
+
+    va_end(ap);
+
+    slot = umap_ordered_probe(this, &mi);
+
+    if (slot == NULL || *slot == 0)
+        return 0;
+
+    if (ret)
+        umap_copy_val(this->val_type, ret, umap_ordered_entry(this, *slot)->value);
+
+    return 1;
+}
+
+umap_entry_t * umap_ordered_find(umap_ordered_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_entry_t mi;
+    uint32_t * slot;
+
+    va_start(ap, this);
+    umap_ordered_va_lookup(this, &mi, ap);
+    va_end(ap);
+
+    slot = umap_ordered_probe(this, &mi);
+
+    if (slot == NULL || *slot == 0)
+        return NULL;
+
+    return umap_ordered_entry(this, *slot);
+}
+
+int umap_ordered_del(umap_ordered_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_entry_t mi,
+                 * entry;
+    uint32_t * slot;
+
+    va_start(ap, this);
+    umap_ordered_va_lookup(this, &mi, ap);
+    va_end(ap);
+
+    slot = umap_ordered_probe(this, &mi);
+
+    if (slot == NULL || *slot == 0)
+        return 0;
+
+    entry = umap_ordered_entry(this, *slot);
+    umap_ordered_unlink(this, slot - this->index);
+
+    /* the entry stays where it is as a hole, so nothing after it moves */
+    entry->is_occupied = 0;
+    this->size--;
+
+    return 1;
+}
+
+umap_entry_t * umap_ordered_next(umap_ordered_t * this, unsigned int * pos)
+{
+    umap_entry_t * entry;
+
+    while (*pos < vector_count(&this->entries))
+    {
+        entry = vector_get(&this->entries, (*pos)++);
+
+        if (entry->is_occupied)
+            return entry;
+    }
+
+    return NULL;
+}
+
+void umap_ordered_reserve(umap_ordered_t * this, unsigned long count)
+{
+    unsigned long num_slots = umap_ordered_slots_for(count);
+
+    if (num_slots > this->num_slots)
+        umap_ordered_rebuild_index(this, num_slots);
+
+    if (count > this->entries.b_size)
+        vector_alloc(&this->entries, count);
+}
+
+void umap_ordered_shrink_to_fit(umap_ordered_t * this)
+{
+    umap_entry_t * entry;
+    unsigned int i,
+                 n = 0;
+
+    if (this->size == 0)
+    {
+        umap_ordered_free(this);
+        vector_init(&this->entries, sizeof(umap_entry_t));
+
+        this->index     = NULL;
+        this->num_slots = 0;
+        return;
+    }
+
+    /* slide the entries over the holes, keeping their order */
+    if (this->size != vector_count(&this->entries))
+    {
+        for (i = 0; i < vector_count(&this->entries); i++)
+        {
+            entry = vector_get(&this->entries, i);
+
+            if (entry->is_occupied)
+                *(umap_entry_t *) vector_get(&this->entries, n++) = *entry;
+        }
+
+        this->entries.count = n;
+    }
+
+    vector_alloc(&this->entries, this->size);
+
+    /* the positions changed, so without memory for a smaller index the old one is rebuilt */
+    if (!umap_ordered_rebuild_index(this, umap_ordered_slots_for(this->size)))
+        umap_ordered_rebuild_index(this, this->num_slots);
+}
+
+unsigned long umap_ordered_memory_usage(umap_ordered_t * this)
+{
+    return this->num_slots * sizeof(uint32_t) + (unsigned long) this->entries.b_size * this->entries.item_size;
+}
+
+void umap_ordered_free(umap_ordered_t * this)
+{
+    free(this->index);
+    vector_free(&this->entries);
+}
+
+void umap_ordered_destroy(umap_ordered_t * this)
+{
+    umap_ordered_free(this);
+    free(this);
+}
+
+/*
+ * the slot of the index that holds mi, or the empty slot its probe ends at.
+ * NULL while there is no index. The load factor keeps a slot empty, so
+ * every probe ends.
+ */
+static uint32_t * umap_ordered_probe(umap_ordered_t * this, umap_entry_t * mi)
+{
+    umap_entry_t * entry;
+    unsigned long i;
+
+    if (this->num_slots == 0)
+        return NULL;
+
+    for (i = umap_ordered_home(this, mi->hash); this->index[i]; i = umap_ordered_next_slot(this, i))
+    {
+        entry = umap_ordered_entry(this, this->index[i]);
+
+        if (entry->hash == mi->hash && umap_key_cmp(this->key_type, entry, mi) == 0)
+            break;
+    }
+
+    return &this->index[i];
+}
+
+/*
+ * Empties slot i of the index. The slots after it in the run move back into
+ * the gap when their home isn't cyclically in between, so no probe stops
+ * short of its key (Knuth's algorithm R).
+ */
+static void umap_ordered_unlink(umap_ordered_t * this, unsigned long i)
+{
+    unsigned long j = i,
+                  home;
+
+    while (this->index[j = umap_ordered_next_slot(this, j)])
+    {
+        home = umap_ordered_home(this, umap_ordered_entry(this, this->index[j])->hash);
+
+        if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+        {
+            this->index[i] = this->index[j];
+            i = j;
+        }
+    }
+
+    this->index[i] = 0;
+}
+
+/*
+ * Indexes the entries again into num_slots slots, in the order they are in
+ * the vector. An index of the same size is reused, otherwise returns 0 and
+ * keeps the old index when there is no memory for the new one.
+ */
+static int umap_ordered_rebuild_index(umap_ordered_t * this, unsigned long num_slots)
+{
+    umap_entry_t * entry;
+    unsigned long i;
+    unsigned int pos;
+
+    if (num_slots == this->num_slots)
+    {
+        memset(this->index, 0, num_slots * sizeof(uint32_t));
+    }
+    else
+    {
+        uint32_t * index = calloc(num_slots, sizeof(uint32_t));
+
+        if (index == NULL)
+            return 0;
+
+        free(this->index);
+
+        this->index     = index;
+        this->num_slots = num_slots;
+    }
+
+    for (pos = 0; pos < vector_count(&this->entries); pos++)
+    {
+        entry = vector_get(&this->entries, pos);
+
+        if (!entry->is_occupied)
+            continue;
+
+        for (i = umap_ordered_home(this, entry->hash); this->index[i]; i = umap_ordered_next_slot(this, i))
+            ;
+
+        this->index[i] = pos + 1;
+    }
+
+    return 1;
+}
+
+/* the smallest index that holds count entries below the load factor */
+static unsigned long umap_ordered_slots_for(unsigned long count)
+{
+    unsigned long num_slots = UMAP_ORDERED_MIN_SLOTS;
+
+    while (count > num_slots * UMAP_ORDERED_LOAD_FACTOR)
+        num_slots *= 2;
+
+    return num_slots;
+}
+
+/*
+ * reads the key off the argument list into mi and hashes it
+ */
+static void umap_ordered_va_lookup(umap_ordered_t * this, umap_entry_t * mi, va_list ap)
+{
+    mi->key = umap_get_va_key(this->key_type, ap);
+    mi->is_occupied = 0;
+    umap_hash_entry_key(this->key_type, this->hash_type, &this->hash_seed, mi);
+}
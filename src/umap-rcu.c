@@ -0,0 +1,128 @@
+#include "lib/umap-rcu.h"
+#include "lib/umap/common.h"
+
+#include <stdlib.h>
+
+static int umap_rcu_entry_eql(void * e1, void * e2, void *);
+
+umap_rcu_t * umap_rcu_create()
+{
+    umap_rcu_t * this = (umap_rcu_t *) malloc(sizeof(umap_rcu_t));
+
+    umap_rcu_init(this);
+
+    return this;
+}
+
+void umap_rcu_init(umap_rcu_t * this)
+{
+    this->key_type = UMAP_KEY_TYPE_STRING;
+    this->val_type = UMAP_VAL_TYPE_DATA;
+
+    hashtable_rcu_init(&this->ht, sizeof(umap_entry_t), umap_rcu_entry_eql, this, HASH_TYPE_MURMUR, NULL);
+}
+
+int umap_rcu_add(umap_rcu_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_entry_t mi;
+
+    /* grab the key and value*/
+    va_start(ap, this);
+
+    mi.key = umap_get_va_key(this->key_type, ap);
+    mi.value = umap_get_va_val(this->val_type, ap);
+
+    va_end(ap);
+
+    /* the key is hashed before the write lock is taken */
+    mi.is_occupied = 1;
+    umap_hash_entry_key(this->key_type, this->ht.hash_type, &this->ht.hash_seed, &mi);
+
+    return hashtable_rcu_insert(&this->ht, &mi);
+}
+
+int umap_rcu_get(umap_rcu_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_datum_t * ret;
+    umap_entry_t mi,
+                 * ht_entry;
+
+    /* grab the key and data return pointer */
+    va_start(ap, this);
+
+    mi.key = umap_get_va_key(this->key_type, ap);
+    ret = va_arg(ap, umap_datum_t *);
+
+    va_end(ap);
+
+    mi.is_occupied = 0;
+    umap_hash_entry_key(this->key_type, this->ht.hash_type, &this->ht.hash_seed, &mi);
+
+    ht_entry = hashtable_rcu_search(&this->ht, &mi);
+
+    if (ht_entry == NULL)
+        return 0;
+
+    if (ret)
+        umap_copy_val(this->val_type, ret, ht_entry->value);
+
+    return 1;
+}
+
+int umap_rcu_del(umap_rcu_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_entry_t mi;
+
+    va_start(ap, this);
+    mi.key = umap_get_va_key(this->key_type, ap);
+    va_end(ap);
+
+    mi.is_occupied = 0;
+    umap_hash_entry_key(this->key_type, this->ht.hash_type, &this->ht.hash_seed, &mi);
+
+    return hashtable_rcu_delete(&this->ht, &mi);
+}
+
+umap_rcu_reader_t * umap_rcu_register(umap_rcu_t * this)
+{
+    return hashtable_rcu_register(&this->ht);
+}
+
+void umap_rcu_unregister(umap_rcu_t * this, umap_rcu_reader_t * reader)
+{
+    hashtable_rcu_unregister(&this->ht, reader);
+}
+
+void umap_rcu_quiescent(umap_rcu_t * this, umap_rcu_reader_t * reader)
+{
+    hashtable_rcu_quiescent(&this->ht, reader);
+}
+
+void umap_rcu_offline(umap_rcu_t * this, umap_rcu_reader_t * reader)
+{
+    hashtable_rcu_offline(&this->ht, reader);
+}
+
+void umap_rcu_online(umap_rcu_t * this, umap_rcu_reader_t * reader)
+{
+    hashtable_rcu_online(&this->ht, reader);
+}
+
+void umap_rcu_free(umap_rcu_t * this)
+{
+    hashtable_rcu_free(&this->ht);
+}
+
+void umap_rcu_destroy(umap_rcu_t * this)
+{
+    umap_rcu_free(this);
+    free(this);
+}
+
+static int umap_rcu_entry_eql(void * e1, void * e2, void * this)
+{
+    return umap_key_cmp(((umap_rcu_t *) this)->key_type, e1, e2);
+}
@@ -1,24 +1,70 @@
 #include "lib/umap.h"
+#include "lib/umap/common.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include "lib/hash.h"
 
-typedef union _umap_datum umap_datum_t;
+static void hash_entry_key(umap_t *, umap_entry_t *);
 
-static unsigned long hash_entry_key(umap_key_type_t, umap_datum_t);
-
-static void umap_entry_init(umap_entry_t *, umap_key_type_t, umap_datum_t, umap_datum_t);
+static void umap_entry_init(umap_t *, umap_entry_t *, umap_datum_t, umap_datum_t);
 
 /* static void umap_attach_item_to_tail(umap_t *, umap_item_t *); */
 
-static int umap_key_eql(umap_t *, umap_datum_t, umap_datum_t);
 static int umap_entry_eql(void * e1, void * e2, void *);
 
-/* inline */ static umap_datum_t umap_get_va_key(umap_t *, va_list);
-/* inline */ static umap_datum_t umap_get_va_val(umap_t *, va_list);
+static void umap_copy_key(umap_t *, umap_entry_t *, unsigned long old_size);
+static void umap_release_key(umap_t *, char * key);
+static void umap_compact_keys(umap_t *);
+
+/* whether the string keys are copies in the key arena */
+#define umap_owns_keys(m) ((m)->own_keys && (m)->key_type == UMAP_KEY_TYPE_STRING)
 
+/* lookups resolved per hashtable_lookup_batch call by the *_many functions */
+#define UMAP_BATCH_SIZE 64
+
+/*
+ * fill in the key, key_len and hash of an entry for the typed functions,
+ * the same as umap_hash_entry_key does for each key type
+ */
+#define umap_int_key(m, mi, k)  ((mi)->key.i = (k), (mi)->key_len = sizeof(int), \
+                                 (mi)->hash = hash_int_type((m)->ht.hash_type, &(m)->ht.hash_seed, (unsigned int) (k)))
+#define umap_dbl_key(m, mi, k)  ((mi)->key.d = (k), (mi)->key_len = sizeof(double), \
+                                 (mi)->hash = hash_double_type((m)->ht.hash_type, &(m)->ht.hash_seed, (k)))
+#define umap_str_key(m, mi, k)  ((mi)->key.p = (k), \
+                                 (mi)->hash = hash_str_len((m)->ht.hash_type, &(m)->ht.hash_seed, (k), &(mi)->key_len))
+
+/* defines umap_put_<k><v> and umap_get_<k><v> */
+#define UMAP_TYPED(k, key_t, set_key, v, val_t, field) \
+    void umap_put_##k##v(umap_t * this, key_t key, val_t val) \
+    { \
+        umap_entry_t mi; \
+        unsigned long size = this->ht.size; \
+        \
+        set_key(this, &mi, key); \
+        mi.value.field  = val; \
+        mi.is_occupied  = 0; \
+        umap_copy_key(this, hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_INSERT), size); \
+    } \
+    \
+    int umap_get_##k##v(umap_t * this, key_t key, val_t * val) \
+    { \
+        umap_entry_t mi, \
+                     * ht_entry; \
+        \
+        set_key(this, &mi, key); \
+        mi.is_occupied = 0; \
+        ht_entry = hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_SEARCH); \
+        \
+        if (ht_entry == NULL) \
+            return 0; \
+        \
+        if (val) \
+            *val = ht_entry->value.field; \
+        \
+        return 1; \
+    }
 
 umap_t * umap_create()
 {
@@ -31,9 +77,12 @@ umap_t * umap_create()
 
 void umap_init(umap_t * this)
 {
-    hashtable_init(&this->ht, sizeof(umap_entry_t), umap_entry_eql, this);
+    hashtable_init(&this->ht, sizeof(umap_entry_t), umap_entry_eql, this, HASH_TYPE_MURMUR, NULL);
     this->key_type  = UMAP_KEY_TYPE_STRING;
     this->val_type  = UMAP_VAL_TYPE_DATA;
+    this->own_keys  = 0;
+    
+    key_arena_init(&this->keys);
 }
 
 void umap_add(umap_t * this, ...)
@@ -43,17 +92,20 @@ void umap_add(umap_t * this, ...)
                  val;
     umap_entry_t mi, 
                  * new_entry;
+    unsigned long size;
 
     /* grab the key and value*/    
     va_start(ap, this);
 
-    key = umap_get_va_key(this, ap);
-    val = umap_get_va_val(this, ap);
+    key = umap_get_va_key(this->key_type, ap);
+    val = umap_get_va_val(this->val_type, ap);
     
     va_end(ap);
     
-    umap_entry_init(&mi, this->key_type, key, val);
+    umap_entry_init(this, &mi, key, val);
+    size = this->ht.size;
     new_entry = hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_INSERT);
+    umap_copy_key(this, new_entry, size);
     
     /*
      * Attach to the linked list
@@ -75,14 +127,14 @@ int umap_get(umap_t * this, ...)
     /* grab the key and data return pointer */
     va_start(ap, this);
     
-    key = umap_get_va_key(this, ap);
+    key = umap_get_va_key(this->key_type, ap);
     ret = va_arg(ap, umap_datum_t *);
     
     va_end(ap);
 
     mi.key  = key;
-    mi.hash = hash_entry_key(this->key_type, key);
     mi.is_occupied = 0;
+    hash_entry_key(this, &mi);
     
     ht_entry = hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_SEARCH);
     
@@ -90,14 +142,122 @@ int umap_get(umap_t * this, ...)
         return 0;
     
     if (ret)
-        *ret = ht_entry->value;
+        umap_copy_val(this->val_type, ret, ht_entry->value);
+    
+    return 1;
+}
+
+int umap_del(umap_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    umap_datum_t key,
+                 * ret;
+                 
+    umap_entry_t mi;
+                        
+    /* grab the key and data return pointer */
+    va_start(ap, this);
+    
+    key = umap_get_va_key(this->key_type, ap);
+    ret = va_arg(ap, umap_datum_t *);
+    
+    va_end(ap);
+
+    mi.key  = key;
+    mi.is_occupied = 0;
+    hash_entry_key(this, &mi);
+    
+    /* the removed entry is copied back into mi */
+    if (hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_DELETE) == NULL)
+        return 0;
+    
+    if (ret)
+        umap_copy_val(this->val_type, ret, mi.value);
+    
+    if (umap_owns_keys(this))
+        umap_release_key(this, mi.key.p);
     
     return 1;
 }
 
+umap_entry_t * umap_next(umap_t * this, umap_cursor_t * cursor)
+{
+    return hashtable_next(&this->ht, cursor);
+}
+
+int umap_get_many(umap_t * this, const void * keys, int num, umap_datum_t * values, int * found)
+{
+    umap_entry_t batch[UMAP_BATCH_SIZE];
+    void * results[UMAP_BATCH_SIZE];
+    int i,
+        j,
+        n,
+        num_found = 0;
+    
+    for (i = 0; i < num; i += n)
+    {
+        n = (num - i < UMAP_BATCH_SIZE) ? num - i : UMAP_BATCH_SIZE;
+        
+        /* hash the whole batch before any of it is looked up */
+        for (j = 0; j < n; j++)
+        {
+            batch[j].key = umap_get_array_key(this->key_type, keys, i + j);
+            batch[j].is_occupied = 0;
+            hash_entry_key(this, &batch[j]);
+        }
+        
+        num_found += hashtable_lookup_batch(&this->ht, batch, n, results);
+        
+        for (j = 0; j < n; j++)
+        {
+            if (values && results[j])
+                umap_copy_val(this->val_type, &values[i + j], ((umap_entry_t *) results[j])->value);
+            
+            if (found)
+                found[i + j] = (results[j] != NULL);
+        }
+    }
+    
+    return num_found;
+}
+
+UMAP_TYPED(i, int, umap_int_key, i, int, i)
+UMAP_TYPED(i, int, umap_int_key, d, double, d)
+UMAP_TYPED(i, int, umap_int_key, p, void *, p)
+UMAP_TYPED(d, double, umap_dbl_key, i, int, i)
+UMAP_TYPED(d, double, umap_dbl_key, d, double, d)
+UMAP_TYPED(d, double, umap_dbl_key, p, void *, p)
+UMAP_TYPED(s, char *, umap_str_key, i, int, i)
+UMAP_TYPED(s, char *, umap_str_key, d, double, d)
+UMAP_TYPED(s, char *, umap_str_key, p, void *, p)
+
+void umap_reserve(umap_t * this, unsigned long count)
+{
+    hashtable_reserve(&this->ht, count);
+}
+
+void umap_shrink_to_fit(umap_t * this)
+{
+    hashtable_shrink_to_fit(&this->ht);
+    
+    if (this->keys.dead)
+        umap_compact_keys(this);
+}
+
+unsigned long umap_memory_usage(umap_t * this)
+{
+    return hashtable_memory_usage(&this->ht) + this->keys.allocated;
+}
+
+void umap_stats(umap_t * this, hashtable_stats_t * stats)
+{
+    hashtable_stats(&this->ht, stats);
+}
+
 void umap_free(umap_t * this)
 {
     hashtable_free(&this->ht);
+    key_arena_free(&this->keys);
 
 /*     umap_item_t * p,
                    * tmp;*/
@@ -139,90 +299,88 @@ void umap_destroy(umap_t * this)
 }*/
 
 
-/* inline */ static umap_datum_t umap_get_va_key(umap_t * this, va_list ap)
+static void hash_entry_key(umap_t * this, umap_entry_t * mi)
 {
-    umap_datum_t key;
-    
-    switch (this->key_type)
-    {
-        case UMAP_KEY_TYPE_INT:
-            key.i = va_arg(ap, int);
-            break;
-        case UMAP_KEY_TYPE_DOUBLE:
-            key.d = va_arg(ap, double);
-            break;
-        case UMAP_KEY_TYPE_STRING:
-            key.p = va_arg(ap, void *);
-            break;
-    }
-    
-    return key;
+    umap_hash_entry_key(this->key_type, this->ht.hash_type, &this->ht.hash_seed, mi);
 }
-/* inline */ static umap_datum_t umap_get_va_val(umap_t * this, va_list ap)
+
+static int umap_entry_eql(void * e1, void * e2, void * this)
 {
-    umap_datum_t val;
-    
-    switch (this->val_type)
-    {
-        case UMAP_VAL_TYPE_INT:
-            val.i = va_arg(ap, int);
-            break;
-        case UMAP_VAL_TYPE_DOUBLE:
-            val.d = va_arg(ap, double);
-            break;
-        case UMAP_VAL_TYPE_DATA:
-            val.p = va_arg(ap, void *);
-            break;
-    }
-    
-    return val;
+    return umap_key_cmp(((umap_t *) this)->key_type, e1, e2);
 }
 
-static int umap_key_eql(umap_t * this, umap_datum_t key1, umap_datum_t key2)
-{
-    switch (this->key_type)
-    {
-        case UMAP_KEY_TYPE_INT:
-            if (key1.i == key2.i)
-                return 0;
-            else if (key1.i < key2.i)
-                return -1;
-            else
-                return 1;
-        case UMAP_KEY_TYPE_DOUBLE:
-            if (key1.d == key2.d)
-                return 0;
-            else if (key1.d < key2.d)
-                return -1;
-            else
-                return 1;
-        case UMAP_KEY_TYPE_STRING:
-            return strcmp(key1.p, key2.p);
-    }
+static void umap_entry_init(umap_t * this, umap_entry_t * mi, umap_datum_t key, umap_datum_t value)
+{    
+    mi->key         = key;
+    mi->value       = value;
+    mi->is_occupied = 0;
+    hash_entry_key(this, mi);
 }
 
-static unsigned long hash_entry_key(umap_key_type_t key_type, umap_datum_t key)
+/*
+ * points the string key of an entry that was just added at a copy in the
+ * key arena, if the map owns its keys. The size only grew if the key is
+ * new, otherwise the entry already has its copy. Without memory for the
+ * copy the entry is taken out again, the map never holds a key it
+ * doesn't own.
+ */
+static void umap_copy_key(umap_t * this, umap_entry_t * entry, unsigned long old_size)
 {
-    switch (key_type)
+    umap_entry_t mi;
+    char * key;
+    
+    if (!umap_owns_keys(this) || this->ht.size == old_size)
+        return;
+    
+    key = key_arena_push(&this->keys, entry->key.p, entry->key_len);
+    
+    if (key)
     {
-        case UMAP_KEY_TYPE_INT:
-            return hash_bytes(&key, sizeof(int));
-        case UMAP_KEY_TYPE_DOUBLE:
-            return hash_bytes(&key, sizeof(double));
-        case UMAP_KEY_TYPE_STRING:
-            return hash_str(key.p);
+        entry->key.p = key;
+        return;
     }
+    
+    /* the delete copies the entry back, so it can't be the table's own */
+    mi = *entry;
+    hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_DELETE);
 }
 
-static int umap_entry_eql(void * e1, void * e2, void * this)
+/*
+ * gives back the arena copy of a deleted key, compacting the arena once
+ * enough of it is dead
+ */
+static void umap_release_key(umap_t * this, char * key)
 {
-    return umap_key_eql(this, ((umap_entry_t * )e1)->key, ((umap_entry_t * )e2)->key);
+    key_arena_release(&this->keys, key);
+    
+    if (key_arena_should_compact(&this->keys))
+        umap_compact_keys(this);
 }
 
-static void umap_entry_init(umap_entry_t * mi, umap_key_type_t key_type, umap_datum_t key, umap_datum_t value)
-{    
-    mi->key         = key;
-    mi->value       = value;
-    mi->hash        = hash_entry_key(key_type, key);
-    mi->is_occupied = 0;
+/*
+ * copies the live keys into one block of a new arena, in the order the
+ * entries sit in the table, and frees the old arena. The pushes all fit in
+ * the reserved block, so none of them can fail.
+ */
+static void umap_compact_keys(umap_t * this)
+{
+    key_arena_t old = this->keys;
+    hashtable_cursor_t cursor;
+    umap_entry_t * entry;
+    
+    key_arena_init(&this->keys);
+    
+    /* without memory for the new block the old arena is kept as it is */
+    if (!key_arena_reserve(&this->keys, key_arena_live(&old)))
+    {
+        this->keys = old;
+        return;
+    }
+    
+    hashtable_cursor_init(&cursor);
+    
+    while ((entry = hashtable_next(&this->ht, &cursor)))
+        entry->key.p = key_arena_push(&this->keys, entry->key.p, entry->key_len);
+    
+    key_arena_free(&old);
 }
@@ -0,0 +1,128 @@
+#include "lib/umap/common.h"
+
+#include <string.h>
+
+umap_datum_t umap_get_array_key(umap_key_type_t key_type, const void * keys, int i)
+{
+    umap_datum_t key;
+    
+    switch (key_type)
+    {
+        case UMAP_KEY_TYPE_INT:
+            key.i = ((const int *) keys)[i];
+            break;
+        case UMAP_KEY_TYPE_DOUBLE:
+            key.d = ((const double *) keys)[i];
+            break;
+        case UMAP_KEY_TYPE_STRING:
+            key.p = ((void * const *) keys)[i];
+            break;
+    }
+    
+    return key;
+}
+
+umap_datum_t umap_get_va_key(umap_key_type_t key_type, va_list ap)
+{
+    umap_datum_t key;
+    
+    switch (key_type)
+    {
+        case UMAP_KEY_TYPE_INT:
+            key.i = va_arg(ap, int);
+            break;
+        case UMAP_KEY_TYPE_DOUBLE:
+            key.d = va_arg(ap, double);
+            break;
+        case UMAP_KEY_TYPE_STRING:
+            key.p = va_arg(ap, void *);
+            break;
+    }
+    
+    return key;
+}
+
+umap_datum_t umap_get_va_val(umap_val_type_t val_type, va_list ap)
+{
+    umap_datum_t val;
+    
+    switch (val_type)
+    {
+        case UMAP_VAL_TYPE_INT:
+            val.i = va_arg(ap, int);
+            break;
+        case UMAP_VAL_TYPE_DOUBLE:
+            val.d = va_arg(ap, double);
+            break;
+        case UMAP_VAL_TYPE_DATA:
+            val.p = va_arg(ap, void *);
+            break;
+    }
+    
+    return val;
+}
+
+void umap_copy_val(umap_val_type_t val_type, void * ret, umap_datum_t val)
+{
+    switch (val_type)
+    {
+        case UMAP_VAL_TYPE_INT:
+            *(int *) ret = val.i;
+            break;
+        case UMAP_VAL_TYPE_DOUBLE:
+            *(double *) ret = val.d;
+            break;
+        case UMAP_VAL_TYPE_DATA:
+            *(void **) ret = val.p;
+            break;
+    }
+}
+
+int umap_key_cmp(umap_key_type_t key_type, umap_entry_t * e1, umap_entry_t * e2)
+{
+    umap_datum_t key1 = e1->key,
+                 key2 = e2->key;
+
+    switch (key_type)
+    {
+        case UMAP_KEY_TYPE_INT:
+            if (key1.i == key2.i)
+                return 0;
+            else if (key1.i < key2.i)
+                return -1;
+            else
+                return 1;
+        case UMAP_KEY_TYPE_DOUBLE:
+            /* NaN keys are all equal to each other and sort after everything else */
+            if (key1.d == key2.d || (key1.d != key1.d && key2.d != key2.d))
+                return 0;
+            else if (key1.d < key2.d || key2.d != key2.d)
+                return -1;
+            else
+                return 1;
+        case UMAP_KEY_TYPE_STRING:
+            /* most mismatches differ in length, so the key bytes are never touched */
+            if (e1->key_len != e2->key_len)
+                return (e1->key_len < e2->key_len) ? -1 : 1;
+            
+            return memcmp(key1.p, key2.p, e1->key_len);
+    }
+}
+
+void umap_hash_entry_key(umap_key_type_t key_type, hash_type_t hash_type, const hash_seed_t * hash_seed, umap_entry_t * mi)
+{
+    switch (key_type)
+    {
+        case UMAP_KEY_TYPE_INT:
+            mi->key_len = sizeof(int);
+            mi->hash    = hash_int_type(hash_type, hash_seed, (unsigned int) mi->key.i);
+            break;
+        case UMAP_KEY_TYPE_DOUBLE:
+            mi->key_len = sizeof(double);
+            mi->hash    = hash_double_type(hash_type, hash_seed, mi->key.d);
+            break;
+        case UMAP_KEY_TYPE_STRING:
+            mi->hash    = hash_str_len(hash_type, hash_seed, mi->key.p, &mi->key_len);
+            break;
+    }
+}
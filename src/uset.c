@@ -1,7 +1,5 @@
 #include "lib/uset.h"
 
-/* DON'T USE THE USET YET */
-
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -9,18 +7,60 @@
 
 typedef union _uset_datum uset_datum_t;
 
-static unsigned long hash_entry_key(uset_key_type_t, uset_datum_t);
+static void hash_entry_key(uset_t *, uset_entry_t *);
 
-static void uset_entry_init(uset_entry_t *, uset_key_type_t, uset_datum_t, uset_datum_t);
+static void uset_entry_init(uset_t *, uset_entry_t *, uset_datum_t);
 
 /* static void uset_attach_item_to_tail(uset_t *, uset_item_t *); */
 
-static int uset_key_eql(uset_t *, uset_datum_t, uset_datum_t);
+static int uset_key_eql(uset_t *, uset_entry_t *, uset_entry_t *);
 static int uset_entry_eql(void * e1, void * e2, void *);
 
+static void uset_copy_key(uset_t *, uset_entry_t *, unsigned long old_size);
+static void uset_release_key(uset_t *, char * key);
+static void uset_compact_keys(uset_t *);
+
+/* whether the string keys are copies in the key arena */
+#define uset_owns_keys(m) ((m)->own_keys && (m)->key_type == USET_KEY_TYPE_STRING)
+
 /* inline */ static uset_datum_t uset_get_va_key(uset_t *, va_list);
-/* inline */ static uset_datum_t uset_get_va_val(uset_t *, va_list);
+/* inline */ static uset_datum_t uset_get_array_key(uset_t *, const void *, int);
 
+/* lookups resolved per hashtable_lookup_batch call by the *_many functions */
+#define USET_BATCH_SIZE 64
+
+/*
+ * fill in the key, key_len and hash of an entry for the typed functions,
+ * the same as hash_entry_key does for each key type
+ */
+#define uset_int_key(s, mi, k)  ((mi)->key.i = (k), (mi)->key_len = sizeof(int), \
+                                 (mi)->hash = hash_int_type((s)->ht.hash_type, &(s)->ht.hash_seed, (unsigned int) (k)))
+#define uset_dbl_key(s, mi, k)  ((mi)->key.d = (k), (mi)->key_len = sizeof(double), \
+                                 (mi)->hash = hash_double_type((s)->ht.hash_type, &(s)->ht.hash_seed, (k)))
+#define uset_str_key(s, mi, k)  ((mi)->key.p = (k), \
+                                 (mi)->hash = hash_str_len((s)->ht.hash_type, &(s)->ht.hash_seed, (k), &(mi)->key_len))
+
+/* defines uset_put_<k> and uset_get_<k> */
+#define USET_TYPED(k, key_t, set_key) \
+    void uset_put_##k(uset_t * this, key_t key) \
+    { \
+        uset_entry_t mi; \
+        unsigned long size = this->ht.size; \
+        \
+        set_key(this, &mi, key); \
+        mi.is_occupied = 0; \
+        uset_copy_key(this, hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_INSERT), size); \
+    } \
+    \
+    int uset_get_##k(uset_t * this, key_t key) \
+    { \
+        uset_entry_t mi; \
+        \
+        set_key(this, &mi, key); \
+        mi.is_occupied = 0; \
+        \
+        return hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_SEARCH) != NULL; \
+    }
 
 uset_t * uset_create()
 {
@@ -33,29 +73,33 @@ uset_t * uset_create()
 
 void uset_init(uset_t * this)
 {
-    hashtable_init(&this->ht, sizeof(uset_entry_t), uset_entry_eql, this);
-    this->key_type  = UMAP_KEY_TYPE_STRING;
-    this->val_type  = UMAP_VAL_TYPE_DATA;
+    hashtable_init(&this->ht, sizeof(uset_entry_t), uset_entry_eql, this, HASH_TYPE_MURMUR, NULL);
+    this->key_type  = USET_KEY_TYPE_STRING;
+    this->val_type  = USET_VAL_TYPE_DATA;
+    this->own_keys  = 0;
+    
+    key_arena_init(&this->keys);
 }
 
 void uset_add(uset_t * this, ...)
 {
     va_list ap; /* arg pointer */
-    uset_datum_t key,
-                      val;
+    uset_datum_t key;
     uset_entry_t mi, 
                  * new_entry;
+    unsigned long size;
 
-    /* grab the key and value*/    
+    /* grab the key */    
     va_start(ap, this);
 
     key = uset_get_va_key(this, ap);
-    val = uset_get_va_val(this, ap);
     
     va_end(ap);
     
-    uset_entry_init(&mi, this->key_type, key, val);
+    uset_entry_init(this, &mi, key);
+    size = this->ht.size;
     new_entry = hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_INSERT);
+    uset_copy_key(this, new_entry, size);
     
     /*
      * Attach to the linked list
@@ -68,38 +112,120 @@ void uset_add(uset_t * this, ...)
 int uset_get(uset_t * this, ...)
 {
     va_list ap; /* arg pointer */
-    uset_datum_t key,
-                 * ret;
+    uset_datum_t key;
                  
     uset_entry_t mi,
                  * ht_entry;
                         
-    /* grab the key and data return pointer */
+    /* grab the key */
     va_start(ap, this);
     
     key = uset_get_va_key(this, ap);
-    ret = va_arg(ap, uset_datum_t *);
     
     va_end(ap);
 
-    mi.key  = key;
-    mi.hash = hash_entry_key(this->key_type, key);
-    mi.is_occupied = 0;
+    uset_entry_init(this, &mi, key);
     
     ht_entry = hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_SEARCH);
     
-    if (ht_entry == NULL)
+    return ht_entry != NULL;
+}
+
+int uset_del(uset_t * this, ...)
+{
+    va_list ap; /* arg pointer */
+    uset_datum_t key;
+                 
+    uset_entry_t mi;
+                        
+    /* grab the key */
+    va_start(ap, this);
+    
+    key = uset_get_va_key(this, ap);
+    
+    va_end(ap);
+
+    uset_entry_init(this, &mi, key);
+    
+    /* the removed entry is copied back into mi */
+    if (hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_DELETE) == NULL)
         return 0;
     
-    if (ret)
-        *ret = ht_entry->value;
+    if (uset_owns_keys(this))
+        uset_release_key(this, mi.key.p);
     
     return 1;
 }
 
+uset_entry_t * uset_next(uset_t * this, uset_cursor_t * cursor)
+{
+    return hashtable_next(&this->ht, cursor);
+}
+
+int uset_has_many(uset_t * this, const void * keys, int num, int * found)
+{
+    uset_entry_t batch[USET_BATCH_SIZE];
+    void * results[USET_BATCH_SIZE];
+    int i,
+        j,
+        n,
+        num_found = 0;
+    
+    for (i = 0; i < num; i += n)
+    {
+        n = (num - i < USET_BATCH_SIZE) ? num - i : USET_BATCH_SIZE;
+        
+        /* hash the whole batch before any of it is looked up */
+        for (j = 0; j < n; j++)
+        {
+            batch[j].key = uset_get_array_key(this, keys, i + j);
+            batch[j].is_occupied = 0;
+            hash_entry_key(this, &batch[j]);
+        }
+        
+        num_found += hashtable_lookup_batch(&this->ht, batch, n, results);
+        
+        for (j = 0; j < n; j++)
+        {
+            if (found)
+                found[i + j] = (results[j] != NULL);
+        }
+    }
+    
+    return num_found;
+}
+
+USET_TYPED(i, int, uset_int_key)
+USET_TYPED(d, double, uset_dbl_key)
+USET_TYPED(s, char *, uset_str_key)
+
+void uset_reserve(uset_t * this, unsigned long count)
+{
+    hashtable_reserve(&this->ht, count);
+}
+
+void uset_shrink_to_fit(uset_t * this)
+{
+    hashtable_shrink_to_fit(&this->ht);
+    
+    if (this->keys.dead)
+        uset_compact_keys(this);
+}
+
+unsigned long uset_memory_usage(uset_t * this)
+{
+    return hashtable_memory_usage(&this->ht) + this->keys.allocated;
+}
+
+void uset_stats(uset_t * this, hashtable_stats_t * stats)
+{
+    hashtable_stats(&this->ht, stats);
+}
+
 void uset_free(uset_t * this)
 {
     hashtable_free(&this->ht);
+    key_arena_free(&this->keys);
 
 /*     uset_item_t * p,
                    * tmp;*/
@@ -141,90 +267,172 @@ void uset_destroy(uset_t * this)
 }*/
 
 
-/* inline */ static uset_datum_t uset_get_va_key(uset_t * this, va_list ap)
+/* inline */ static uset_datum_t uset_get_array_key(uset_t * this, const void * keys, int i)
 {
     uset_datum_t key;
     
     switch (this->key_type)
     {
-        case UMAP_KEY_TYPE_INT:
-            key.i = va_arg(ap, int);
+        case USET_KEY_TYPE_INT:
+            key.i = ((const int *) keys)[i];
             break;
-        case UMAP_KEY_TYPE_DOUBLE:
-            key.d = va_arg(ap, double);
+        case USET_KEY_TYPE_DOUBLE:
+            key.d = ((const double *) keys)[i];
             break;
-        case UMAP_KEY_TYPE_STRING:
-            key.p = va_arg(ap, void *);
+        case USET_KEY_TYPE_STRING:
+            key.p = ((void * const *) keys)[i];
+            break;
+        default:
+            key.p = NULL;
             break;
     }
     
     return key;
 }
-/* inline */ static uset_datum_t uset_get_va_val(uset_t * this, va_list ap)
+/* inline */ static uset_datum_t uset_get_va_key(uset_t * this, va_list ap)
 {
-    uset_datum_t val;
+    uset_datum_t key;
     
-    switch (this->val_type)
+    switch (this->key_type)
     {
-        case UMAP_VAL_TYPE_INT:
-            val.i = va_arg(ap, int);
+        case USET_KEY_TYPE_INT:
+            key.i = va_arg(ap, int);
             break;
-        case UMAP_VAL_TYPE_DOUBLE:
-            val.d = va_arg(ap, double);
+        case USET_KEY_TYPE_DOUBLE:
+            key.d = va_arg(ap, double);
             break;
-        case UMAP_VAL_TYPE_DATA:
-            val.p = va_arg(ap, void *);
+        case USET_KEY_TYPE_STRING:
+            key.p = va_arg(ap, void *);
             break;
     }
     
-    return val;
+    return key;
 }
-
-static int uset_key_eql(uset_t * this, uset_datum_t key1, uset_datum_t key2)
+static int uset_key_eql(uset_t * this, uset_entry_t * e1, uset_entry_t * e2)
 {
+    uset_datum_t key1 = e1->key,
+                 key2 = e2->key;
+
     switch (this->key_type)
     {
-        case UMAP_KEY_TYPE_INT:
+        case USET_KEY_TYPE_INT:
             if (key1.i == key2.i)
                 return 0;
             else if (key1.i < key2.i)
                 return -1;
             else
                 return 1;
-        case UMAP_KEY_TYPE_DOUBLE:
-            if (key1.d == key2.d)
+        case USET_KEY_TYPE_DOUBLE:
+            /* NaN keys are all equal to each other and sort after everything else */
+            if (key1.d == key2.d || (key1.d != key1.d && key2.d != key2.d))
                 return 0;
-            else if (key1.d < key2.d)
+            else if (key1.d < key2.d || key2.d != key2.d)
                 return -1;
             else
                 return 1;
-        case UMAP_KEY_TYPE_STRING:
-            return strcmp(key1.p, key2.p);
+        case USET_KEY_TYPE_STRING:
+            /* most mismatches differ in length, so the key bytes are never touched */
+            if (e1->key_len != e2->key_len)
+                return (e1->key_len < e2->key_len) ? -1 : 1;
+            
+            return memcmp(key1.p, key2.p, e1->key_len);
     }
 }
 
-static unsigned long hash_entry_key(uset_key_type_t key_type, uset_datum_t key)
+static void hash_entry_key(uset_t * this, uset_entry_t * mi)
 {
-    switch (key_type)
+    switch (this->key_type)
     {
-        case UMAP_KEY_TYPE_INT:
-            return hash_bytes(&key, sizeof(int));
-        case UMAP_KEY_TYPE_DOUBLE:
-            return hash_bytes(&key, sizeof(double));
-        case UMAP_KEY_TYPE_STRING:
-            return hash_str(key.p);
+        case USET_KEY_TYPE_INT:
+            mi->key_len = sizeof(int);
+            mi->hash    = hash_int_type(this->ht.hash_type, &this->ht.hash_seed, (unsigned int) mi->key.i);
+            break;
+        case USET_KEY_TYPE_DOUBLE:
+            mi->key_len = sizeof(double);
+            mi->hash    = hash_double_type(this->ht.hash_type, &this->ht.hash_seed, mi->key.d);
+            break;
+        case USET_KEY_TYPE_STRING:
+            mi->hash    = hash_str_len(this->ht.hash_type, &this->ht.hash_seed, mi->key.p, &mi->key_len);
+            break;
     }
 }
 
 static int uset_entry_eql(void * e1, void * e2, void * this)
 {
-    return uset_key_eql(this, ((uset_entry_t * )e1)->key, ((uset_entry_t * )e2)->key);
+    return uset_key_eql(this, e1, e2);
 }
 
-static void uset_entry_init(uset_entry_t * mi, uset_key_type_t key_type, uset_datum_t key, umap_datum_t value)
+static void uset_entry_init(uset_t * this, uset_entry_t * mi, uset_datum_t key)
 {    
     mi->key         = key;
-    mi->value       = value;
-    mi->hash        = hash_entry_key(key_type, key);
     mi->is_occupied = 0;
+    hash_entry_key(this, mi);
+}
+
+/*
+ * points the string key of an entry that was just added at a copy in the
+ * key arena, if the set owns its keys. The size only grew if the key is
+ * new, otherwise the entry already has its copy. Without memory for the
+ * copy the entry is taken out again, the set never holds a key it
+ * doesn't own.
+ */
+static void uset_copy_key(uset_t * this, uset_entry_t * entry, unsigned long old_size)
+{
+    uset_entry_t mi;
+    char * key;
+    
+    if (!uset_owns_keys(this) || this->ht.size == old_size)
+        return;
+    
+    key = key_arena_push(&this->keys, entry->key.p, entry->key_len);
+    
+    if (key)
+    {
+        entry->key.p = key;
+        return;
+    }
+    
+    /* the delete copies the entry back, so it can't be the table's own */
+    mi = *entry;
+    hashtable_lookup_entry(&this->ht, &mi, HASHTABLE_LOOKUP_DELETE);
+}
+
+/*
+ * gives back the arena copy of a deleted key, compacting the arena once
+ * enough of it is dead
+ */
+static void uset_release_key(uset_t * this, char * key)
+{
+    key_arena_release(&this->keys, key);
+    
+    if (key_arena_should_compact(&this->keys))
+        uset_compact_keys(this);
+}
+
+/*
+ * copies the live keys into one block of a new arena, in the order the
+ * entries sit in the table, and frees the old arena. The pushes all fit in
+ * the reserved block, so none of them can fail.
+ */
+static void uset_compact_keys(uset_t * this)
+{
+    key_arena_t old = this->keys;
+    hashtable_cursor_t cursor;
+    uset_entry_t * entry;
+    
+    key_arena_init(&this->keys);
+    
+    /* without memory for the new block the old arena is kept as it is */
+    if (!key_arena_reserve(&this->keys, key_arena_live(&old)))
+    {
+        this->keys = old;
+        return;
+    }
+    
+    hashtable_cursor_init(&cursor);
+    
+    while ((entry = hashtable_next(&this->ht, &cursor)))
+        entry->key.p = key_arena_push(&this->keys, entry->key.p, entry->key_len);
+    
+    key_arena_free(&old);
 }
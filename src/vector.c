@@ -69,6 +69,7 @@ void vector_alloc(vector_t * this, int size)
 		
 	this->b_size = size;
 	this->data = realloc(this->data, this->item_size * this->b_size);
+	this->has_init = 1; /* or the first push would allocate over it */
 }
 
 void * vector_push(vector_t * this)